@@ -0,0 +1,132 @@
+#ifndef BER_BERBUILDER_H
+#define BER_BERBUILDER_H
+
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "EncodedBerObject.h"
+
+namespace BER {
+    /**
+     * Single-pass encoder for constructed types. Children are written straight into one buffer,
+     * the definite length of every level is patched in when the level is closed.
+     * Contents are shifted only if the length octets turn out to need more (or less) room
+     * than was reserved in Begin().
+     */
+    class BerBuilder {
+        struct Level {
+            std::size_t id_pos;
+            std::size_t length_pos;
+            std::size_t reserved;
+            std::uintmax_t universal_tag; // max for other classes
+        };
+
+        EncodedBerObject buffer_;
+        std::pmr::vector<Level> levels_;
+
+    public:
+        explicit BerBuilder(std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+                buffer_(resource), levels_(resource) {}
+
+        /**
+         * Open a constructed TLV, tag numbers from 31 on take the high-tag-number form.
+         * @param length_hint expected contents' length, used to reserve the length octets
+         */
+        BerBuilder &Begin(IdentifierOctet::ClassTagType class_tag, std::uintmax_t tag_number,
+                          std::size_t length_hint = 0) {
+            const auto id_pos = buffer_.size();
+            buffer_.resize(id_pos + detail::IdentifierSize(tag_number));
+            detail::WriteIdentifier(class_tag, true, tag_number, buffer_.begin() + id_pos);
+
+            const auto reserved = detail::LengthSize(length_hint);
+            levels_.push_back({id_pos, buffer_.size(), reserved,
+                               class_tag.value == IdentifierOctet::Universal.value
+                               ? tag_number : std::numeric_limits<std::uintmax_t>::max()});
+            buffer_.resize(buffer_.size() + reserved);
+            return *this;
+        }
+
+        BerBuilder &Begin(UniversalTagList::Type tag = UniversalTagList::SEQUENCE, std::size_t length_hint = 0) {
+            return Begin(IdentifierOctet::Universal, static_cast<std::uintmax_t>(tag), length_hint);
+        }
+
+        /**
+         * Close the innermost open TLV.
+         */
+        BerBuilder &End() {
+            if (levels_.empty()) {
+                throw std::logic_error{"No open constructed encoding"};
+            }
+
+            const auto level = levels_.back();
+            levels_.pop_back();
+
+            const auto content_pos = level.length_pos + level.reserved;
+            const auto content_sz = buffer_.size() - content_pos;
+            const auto needed = detail::LengthSize(content_sz);
+
+            if (needed > level.reserved) {
+                buffer_.insert(buffer_.begin() + content_pos, needed - level.reserved, Octet{0});
+            } else if (needed < level.reserved) {
+                buffer_.erase(buffer_.begin() + level.length_pos + needed, buffer_.begin() + content_pos);
+            }
+
+            detail::WriteLength(content_sz, buffer_.begin() + level.length_pos);
+            Instrumentation::RecordEncoded(level.universal_tag, buffer_.size() - level.id_pos);
+            return *this;
+        }
+
+        /**
+         * Append an encoded value, see EncodeTo().
+         */
+        template<class T>
+        BerBuilder &Add(const T &value) {
+            const auto pos = buffer_.size();
+            buffer_.resize(pos + EncodedSize(value));
+            EncodeTo(value, buffer_.data() + pos);
+            return *this;
+        }
+
+        /**
+         * Append an already encoded TLV as is.
+         */
+        BerBuilder &AddEncoded(OctetView tlv) {
+            buffer_.insert(buffer_.end(), tlv.begin(), tlv.end());
+            return *this;
+        }
+
+        [[nodiscard]] std::size_t Depth() const noexcept {
+            return levels_.size();
+        }
+
+        [[nodiscard]] OctetView View() const noexcept {
+            return {buffer_.data(), buffer_.size()};
+        }
+
+        /**
+         * Take the encoded result, all levels shall be closed. The builder is left empty.
+         */
+        EncodedBerObject Release() {
+            if (!levels_.empty()) {
+                throw std::logic_error{"Constructed encoding is not closed"};
+            }
+            EncodedBerObject result{buffer_.get_allocator()};
+            std::swap(result, buffer_);
+            return result;
+        }
+
+        void Clear() noexcept {
+            buffer_.clear();
+            levels_.clear();
+        }
+    };
+}
+
+#endif //BER_BERBUILDER_H
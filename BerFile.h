@@ -0,0 +1,317 @@
+#ifndef BER_BERFILE_H
+#define BER_BERFILE_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "TlvView.h"
+
+namespace BER {
+    /**
+     * Read-only memory mapping of a whole file (POSIX).
+     */
+    class MappedFile {
+        int fd_{-1};
+        const Octet *data_{};
+        std::size_t size_{};
+
+        void Close() noexcept {
+            if (data_ != nullptr) {
+                ::munmap(const_cast<Octet *>(data_), size_);
+            }
+            if (fd_ != -1) {
+                ::close(fd_);
+            }
+            data_ = nullptr;
+            fd_ = -1;
+            size_ = 0;
+        }
+
+    public:
+        explicit MappedFile(const std::string &path) {
+            fd_ = ::open(path.c_str(), O_RDONLY);
+            if (fd_ == -1) {
+                throw std::system_error{errno, std::generic_category(), "open " + path};
+            }
+
+            struct stat st{};
+            if (::fstat(fd_, &st) == -1) {
+                const int err = errno;
+                Close();
+                throw std::system_error{err, std::generic_category(), "fstat " + path};
+            }
+
+            size_ = static_cast<std::size_t>(st.st_size);
+            if (size_ != 0) {
+                void *p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+                if (p == MAP_FAILED) {
+                    const int err = errno;
+                    Close();
+                    throw std::system_error{err, std::generic_category(), "mmap " + path};
+                }
+                data_ = static_cast<const Octet *>(p);
+            }
+        }
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        MappedFile(MappedFile &&other) noexcept:
+                fd_(std::exchange(other.fd_, -1)),
+                data_(std::exchange(other.data_, nullptr)),
+                size_(std::exchange(other.size_, 0)) {}
+
+        MappedFile &operator=(MappedFile &&other) noexcept {
+            if (this != &other) {
+                Close();
+                fd_ = std::exchange(other.fd_, -1);
+                data_ = std::exchange(other.data_, nullptr);
+                size_ = std::exchange(other.size_, 0);
+            }
+            return *this;
+        }
+
+        ~MappedFile() {
+            Close();
+        }
+
+        [[nodiscard]] OctetView View() const noexcept {
+            return {data_, size_};
+        }
+
+        /**
+         * Hint the kernel about the access pattern, e.g. MADV_SEQUENTIAL for a full scan.
+         */
+        void Advise(int advice) const noexcept {
+            if (data_ != nullptr) {
+                ::madvise(const_cast<Octet *>(data_), size_, advice);
+            }
+        }
+    };
+
+    /**
+     * Reader of a file of concatenated TLVs. Records are handed out as views into the mapping,
+     * their positions are kept in an offset index built by a header-only scan.
+     */
+    class BerFileReader {
+    public:
+        struct IndexEntry {
+            std::uint64_t offset;
+            std::uint64_t size;
+            std::uint64_t first_child; // into Children(), valid if the index has second-level entries
+            std::uint64_t child_count;
+        };
+
+        struct ChildEntry {
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+    private:
+        static constexpr char index_magic[8] = {'B', 'E', 'R', 'I', 'D', 'X', '0', '1'};
+        static constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+        struct IndexFileHeader {
+            char magic[8];
+            std::uint32_t byte_order;
+            std::uint32_t second_level;
+            std::uint64_t scanned_size;
+            std::uint64_t records;
+            std::uint64_t children;
+        };
+
+        MappedFile file_;
+        std::vector<IndexEntry> records_;
+        std::vector<ChildEntry> children_;
+        std::uint64_t scanned_size_{};
+        bool second_level_{};
+
+        static bool IsFiller(Octet octet) noexcept {
+            return octet == 0x00 || octet == 0xFF;
+        }
+
+    public:
+        explicit BerFileReader(const std::string &path) : file_(path) {}
+
+        [[nodiscard]] OctetView View() const noexcept {
+            return file_.View();
+        }
+
+        /**
+         * Scan top-level TLVs (and optionally their children) from the end of the already indexed part,
+         * only identifier and length octets are read. The scan stops at a truncated or malformed record.
+         * @param skip_filler skip 0x00/0xFF padding octets between records (block-padded billing files)
+         * @return number of octets left unindexed at the end of the file
+         */
+        std::size_t BuildIndex(bool second_level = false, bool skip_filler = false) {
+            if (!records_.empty() && second_level != second_level_) {
+                throw std::logic_error{"Index level mismatch"};
+            }
+            second_level_ = second_level;
+
+            const auto view = file_.View();
+            std::size_t pos = scanned_size_;
+            std::vector<ChildEntry> children; // of the current record, kept only once it parsed whole
+
+            while (pos < view.size()) {
+                if (skip_filler && IsFiller(view[pos])) {
+                    ++pos;
+                    scanned_size_ = pos;
+                    continue;
+                }
+
+                TlvView tlv;
+                children.clear();
+                try {
+                    tlv = TlvView{view.substr(pos)};
+                    if (second_level && tlv.IsConstructed()) {
+                        for (auto &&child : tlv.Children()) {
+                            children.push_back({static_cast<std::uint64_t>(child.Bytes().data() - view.data()),
+                                                child.Bytes().size()});
+                        }
+                    }
+                } catch (const std::logic_error &) {
+                    break;
+                }
+
+                records_.push_back({pos, tlv.Bytes().size(), children_.size(), children.size()});
+                children_.insert(children_.end(), children.begin(), children.end());
+
+                pos += tlv.Bytes().size();
+                scanned_size_ = pos;
+            }
+
+            return view.size() - scanned_size_;
+        }
+
+        [[nodiscard]] std::size_t RecordCount() const noexcept {
+            return records_.size();
+        }
+
+        [[nodiscard]] TlvView Record(std::size_t n) const {
+            const auto &entry = records_.at(n);
+            return TlvView{file_.View().substr(entry.offset, entry.size)};
+        }
+
+        /**
+         * Children of record n, requires an index built with second_level.
+         */
+        [[nodiscard]] TlvView Child(std::size_t n, std::size_t i) const {
+            const auto &entry = records_.at(n);
+            if (!second_level_ || i >= entry.child_count) {
+                throw std::out_of_range{"No such child"};
+            }
+            const auto &child = children_[entry.first_child + i];
+            return TlvView{file_.View().substr(child.offset, child.size)};
+        }
+
+        [[nodiscard]] const std::vector<IndexEntry> &Records() const noexcept {
+            return records_;
+        }
+
+        [[nodiscard]] const std::vector<ChildEntry> &Children() const noexcept {
+            return children_;
+        }
+
+        /**
+         * Write the index to a sidecar file (native byte order).
+         */
+        void SaveIndex(const std::string &path) const {
+            const std::unique_ptr<std::FILE, int (*)(std::FILE *)> f{std::fopen(path.c_str(), "wb"), std::fclose};
+            if (!f) {
+                throw std::system_error{errno, std::generic_category(), "fopen " + path};
+            }
+
+            IndexFileHeader header{};
+            std::memcpy(header.magic, index_magic, sizeof(index_magic));
+            header.byte_order = byte_order_mark;
+            header.second_level = second_level_;
+            header.scanned_size = scanned_size_;
+            header.records = records_.size();
+            header.children = children_.size();
+
+            if (std::fwrite(&header, sizeof(header), 1, f.get()) != 1 ||
+                std::fwrite(records_.data(), sizeof(IndexEntry), records_.size(), f.get()) != records_.size() ||
+                std::fwrite(children_.data(), sizeof(ChildEntry), children_.size(), f.get()) != children_.size() ||
+                std::fflush(f.get()) != 0) {
+                throw std::system_error{errno, std::generic_category(), "fwrite " + path};
+            }
+        }
+
+        /**
+         * Load a sidecar index. An index of a shorter file is accepted (the file was appended to since),
+         * BuildIndex() then continues the scan where the saved one stopped.
+         * @return false if there is no usable index, the current index is left untouched then
+         */
+        bool LoadIndex(const std::string &path) {
+            const std::unique_ptr<std::FILE, int (*)(std::FILE *)> f{std::fopen(path.c_str(), "rb"), std::fclose};
+            if (!f) {
+                return false;
+            }
+
+            IndexFileHeader header{};
+            if (std::fread(&header, sizeof(header), 1, f.get()) != 1 ||
+                std::memcmp(header.magic, index_magic, sizeof(index_magic)) != 0 ||
+                header.byte_order != byte_order_mark ||
+                header.scanned_size > file_.View().size()) {
+                return false;
+            }
+
+            // the counts are untrusted, they shall fit into the index file before anything is allocated
+            struct stat st{};
+            if (::fstat(::fileno(f.get()), &st) != 0 || static_cast<std::uint64_t>(st.st_size) < sizeof(header)) {
+                return false;
+            }
+            const auto payload = static_cast<std::uint64_t>(st.st_size) - sizeof(header);
+            if (header.records > payload / sizeof(IndexEntry) ||
+                header.children > (payload - header.records * sizeof(IndexEntry)) / sizeof(ChildEntry)) {
+                return false;
+            }
+
+            std::vector<IndexEntry> records(header.records);
+            std::vector<ChildEntry> children(header.children);
+            if (std::fread(records.data(), sizeof(IndexEntry), records.size(), f.get()) != records.size() ||
+                std::fread(children.data(), sizeof(ChildEntry), children.size(), f.get()) != children.size()) {
+                return false;
+            }
+            const auto within_scan = [&](std::uint64_t offset, std::uint64_t size) {
+                return offset <= header.scanned_size && size <= header.scanned_size - offset;
+            };
+            for (auto &&entry : records) {
+                if (!within_scan(entry.offset, entry.size) || entry.first_child > children.size() ||
+                    entry.child_count > children.size() - entry.first_child) {
+                    return false;
+                }
+            }
+            for (auto &&child : children) {
+                if (!within_scan(child.offset, child.size)) {
+                    return false;
+                }
+            }
+
+            records_ = std::move(records);
+            children_ = std::move(children);
+            scanned_size_ = header.scanned_size;
+            second_level_ = header.second_level != 0;
+            return true;
+        }
+    };
+}
+
+#endif //BER_BERFILE_H
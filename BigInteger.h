@@ -0,0 +1,292 @@
+#ifndef BER_BIGINTEGER_H
+#define BER_BIGINTEGER_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "EncodedBerObject.h"
+#include "Instrumentation.h"
+#include "HeaderParser.h"
+
+namespace BER {
+    /**
+     * Non-owning view of INTEGER contents of any length (RSA moduli, certificate serial numbers):
+     * two's complement, most significant octet first. Redundant leading sign octets are dropped.
+     */
+    class BigIntegerView {
+        OctetView octets_;
+
+    public:
+        BigIntegerView() = default;
+
+        /**
+         * @param octets two's complement contents, at least one octet
+         */
+        explicit BigIntegerView(OctetView octets) : octets_(octets) {
+            if (octets_.empty()) {
+                throw std::logic_error{"Empty integer"};
+            }
+            while (octets_.size() > 1 && ((octets_[0] == 0x00 && octets_[1] < 0x80) ||
+                                          (octets_[0] == 0xFF && octets_[1] >= 0x80))) {
+                octets_.remove_prefix(1);
+            }
+        }
+
+        [[nodiscard]] bool IsNegative() const noexcept {
+            return !octets_.empty() && octets_[0] >= 0x80;
+        }
+
+        /**
+         * -1, 0 or 1.
+         */
+        [[nodiscard]] int Sign() const noexcept {
+            if (IsNegative()) {
+                return -1;
+            }
+            return octets_.size() > 1 || (octets_.size() == 1 && octets_[0] != 0) ? 1 : 0;
+        }
+
+        /**
+         * Minimal two's complement contents.
+         */
+        [[nodiscard]] OctetView Octets() const noexcept {
+            return octets_;
+        }
+
+        /**
+         * Big-endian magnitude without leading zero octets, empty for zero.
+         * Only non-negative values have theirs on the wire, see ToLimbs() for the others.
+         */
+        [[nodiscard]] OctetView Magnitude() const {
+            if (IsNegative()) {
+                throw std::logic_error{"Negative integer has no borrowed magnitude"};
+            }
+            return octets_.substr(!octets_.empty() && octets_[0] == 0x00 ? 1 : 0);
+        }
+
+        /**
+         * Number of limbs ToLimbs() writes. For a negative value the top one may be zero.
+         */
+        template<class Limb>
+        [[nodiscard]] std::size_t LimbCount() const noexcept {
+            const auto size = IsNegative() ? octets_.size() : Magnitude().size();
+            return (size + sizeof(Limb) - 1) / sizeof(Limb);
+        }
+
+        /**
+         * Write the magnitude into caller's limbs, least significant first; the sign is Sign().
+         * Octets are read 8 at a time with byte-swapping loads, negative values are negated a word at a time.
+         * @return number of written limbs, see LimbCount()
+         */
+        template<class Limb, typename = std::enable_if_t<std::is_unsigned_v<Limb> && sizeof(Limb) <= 8>>
+        std::size_t ToLimbs(std::span<Limb> limbs) const {
+            constexpr std::size_t per_word = sizeof(std::uint64_t) / sizeof(Limb);
+            const bool negative = IsNegative();
+            const auto src = negative ? octets_ : Magnitude();
+            const auto count = LimbCount<Limb>();
+            if (limbs.size() < count) {
+                throw std::length_error{"Buffer is too small"};
+            }
+
+            std::uint64_t carry = 1;
+            for (std::size_t w = 0; w * per_word < count; ++w) {
+                const auto end = src.size() - std::min(src.size(), 8 * w);
+                std::uint64_t v;
+                if (end >= sizeof(v)) {
+                    v = LoadBigEndian64(src.data() + end - sizeof(v));
+                } else {
+                    Octet chunk[sizeof(v)];
+                    std::memset(chunk, negative ? 0xFF : 0x00, sizeof(chunk));
+                    std::memcpy(chunk + sizeof(chunk) - end, src.data(), end);
+                    v = LoadBigEndian64(chunk);
+                }
+                if (negative) {
+                    v = ~v + carry;
+                    carry = carry != 0 && v == 0;
+                }
+                for (std::size_t i = 0; i < per_word && w * per_word + i < count; ++i) {
+                    limbs[w * per_word + i] = static_cast<Limb>(v >> (8 * sizeof(Limb) * i));
+                }
+            }
+            return count;
+        }
+
+        friend bool operator==(const BigIntegerView &lhs, const BigIntegerView &rhs) noexcept {
+            return lhs.octets_ == rhs.octets_;
+        }
+    };
+
+    /**
+     * Sign and magnitude of a big INTEGER to be encoded, limbs are least significant first
+     * as in GMP and most bignum libraries. Leading zero limbs are allowed.
+     */
+    template<class Limb>
+    struct BigIntegerLimbs {
+        static_assert(std::is_unsigned_v<Limb> && sizeof(Limb) <= sizeof(std::uint64_t));
+
+        std::span<const Limb> magnitude;
+        bool negative = false;
+    };
+
+    namespace detail {
+        /**
+         * Limbs that matter for the encoding, found once per value.
+         */
+        struct BigIntegerLayout {
+            std::size_t used;         // limbs up to the most significant non-zero one
+            std::size_t lowest;       // the least significant non-zero limb, negation borrows up to it
+            std::size_t content_size; // minimal two's complement octets
+            bool negative;
+        };
+
+        template<class Limb>
+        BigIntegerLayout MakeBigIntegerLayout(const BigIntegerLimbs<Limb> &value) noexcept {
+            const auto &m = value.magnitude;
+            std::size_t used = m.size();
+            while (used > 0 && m[used - 1] == 0) {
+                --used;
+            }
+            if (used == 0) {
+                return {0, 0, 1, false}; // -0 is 0
+            }
+            std::size_t lowest = 0;
+            while (m[lowest] == 0) {
+                ++lowest;
+            }
+
+            // a negative value -m takes as many octets as the non-negative m - 1 (cf. IntegralContentSize())
+            Limb top = m[used - 1];
+            if (value.negative && lowest == used - 1) {
+                --top;
+            }
+            const auto below = (used - 1) * sizeof(Limb);
+            const auto content_size = top == 0 ? below + 1 : below + std::bit_width(top) / 8 + 1;
+            return {used, lowest, content_size, value.negative};
+        }
+
+        /**
+         * Limb i of the two's complement representation, sign extended past the magnitude.
+         */
+        template<class Limb>
+        Limb TwosComplementLimb(const BigIntegerLimbs<Limb> &value, const BigIntegerLayout &layout,
+                                std::size_t i) noexcept {
+            if (i >= layout.used) {
+                return layout.negative ? static_cast<Limb>(~Limb{0}) : Limb{0};
+            }
+            if (!layout.negative || i < layout.lowest) {
+                return value.magnitude[i];
+            }
+            return static_cast<Limb>(i == layout.lowest ? -value.magnitude[i] : ~value.magnitude[i]);
+        }
+
+        template<class Limb, class OutputIt>
+        OutputIt WriteBigIntegerContent(const BigIntegerLimbs<Limb> &value, const BigIntegerLayout &layout,
+                                        OutputIt out) {
+            constexpr std::size_t limb_bytes = sizeof(Limb);
+            const auto limb_cnt = (layout.content_size + limb_bytes - 1) / limb_bytes;
+            Octet chunk[sizeof(std::uint64_t)];
+
+            // the top limb contributes only its low octets, the sign octet may be a limb of its own
+            const auto head = layout.content_size - (limb_cnt - 1) * limb_bytes;
+            StoreBigEndian64(chunk, static_cast<std::uint64_t>(TwosComplementLimb(value, layout, limb_cnt - 1)));
+            out = std::copy(chunk + sizeof(chunk) - head, chunk + sizeof(chunk), out);
+
+            for (auto i = limb_cnt - 1; i-- > 0;) {
+                StoreBigEndian64(chunk, static_cast<std::uint64_t>(TwosComplementLimb(value, layout, i)));
+                if constexpr(std::is_pointer_v<OutputIt>) {
+                    std::memcpy(out, chunk + sizeof(chunk) - limb_bytes, limb_bytes);
+                    out += limb_bytes;
+                } else {
+                    out = std::copy(chunk + sizeof(chunk) - limb_bytes, chunk + sizeof(chunk), out);
+                }
+            }
+            return out;
+        }
+
+        template<class OutputIt>
+        OutputIt WriteBigIntegerHeader(std::size_t content_sz, OutputIt out) {
+            Instrumentation::RecordEncoded(UniversalTagList::INTEGER, 1 + LengthSize(content_sz) + content_sz);
+            *out++ = IdentifierOctet{
+                    IdentifierOctet::Universal,
+                    IdentifierOctet::Constructed{false},
+                    IdentifierOctet::TagNumberType{UniversalTagList::INTEGER}
+            };
+            return WriteLength(content_sz, out);
+        }
+    }
+
+    inline std::size_t EncodedSize(const BigIntegerView &value) noexcept {
+        const auto content_sz = std::max<std::size_t>(value.Octets().size(), 1);
+        return 1 + detail::LengthSize(content_sz) + content_sz;
+    }
+
+    template<class Limb>
+    std::size_t EncodedSize(const BigIntegerLimbs<Limb> &value) noexcept {
+        const auto content_sz = detail::MakeBigIntegerLayout(value).content_size;
+        return 1 + detail::LengthSize(content_sz) + content_sz;
+    }
+
+    template<class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(const BigIntegerView &value, OutputIt out) {
+        const auto octets = value.Octets();
+        if (octets.empty()) {
+            out = detail::WriteBigIntegerHeader(1, out);
+            *out++ = Octet(0);
+            return out;
+        }
+        out = detail::WriteBigIntegerHeader(octets.size(), out);
+        return std::copy(octets.begin(), octets.end(), out);
+    }
+
+    /**
+     * Encode in the minimal two's complement form, a limb at a time.
+     */
+    template<class Limb, class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(const BigIntegerLimbs<Limb> &value, OutputIt out) {
+        const auto layout = detail::MakeBigIntegerLayout(value);
+        out = detail::WriteBigIntegerHeader(layout.content_size, out);
+        return detail::WriteBigIntegerContent(value, layout, out);
+    }
+
+    inline EncodedBerObject Encode(const BigIntegerView &value) {
+        EncodedBerObject result(EncodedSize(value));
+        EncodeTo(value, result.data());
+        return result;
+    }
+
+    template<class Limb>
+    EncodedBerObject Encode(const BigIntegerLimbs<Limb> &value) {
+        EncodedBerObject result(EncodedSize(value));
+        EncodeTo(value, result.data());
+        return result;
+    }
+
+    /**
+     * View the contents of a primitive INTEGER TLV spanning the whole input, nothing is copied.
+     */
+    inline BigIntegerView DecodeBigIntegerView(OctetView encoded) {
+        const auto header = ParseHeader(encoded);
+        if (header.identifier.ClassTag().value != IdentifierOctet::Universal.value ||
+            header.tag_number != UniversalTagList::INTEGER) {
+            throw std::logic_error{"Unexpected tag"};
+        }
+        if (header.identifier.IsConstructed()) {
+            throw std::logic_error{"Constructed encoding is not allowed"};
+        }
+        if (header.length != encoded.size() - header.header_size) {
+            throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+        }
+        return BigIntegerView{encoded.substr(header.header_size)};
+    }
+}
+
+#endif //BER_BIGINTEGER_H
@@ -0,0 +1,372 @@
+#ifndef BER_BITSTRING_H
+#define BER_BITSTRING_H
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "EncodedBerObject.h"
+#include "Instrumentation.h"
+#include "HeaderParser.h"
+#include "TlvView.h"
+
+namespace BER {
+    /**
+     * Numbering of bits in a word buffer. BER numbers bits from the most significant bit of the first octet.
+     */
+    enum class BitOrder {
+        Lsb0, // bit i is (word[i / W] >> (i % W)) & 1, as in std::bitset and most bitmaps
+        Msb0  // bit i is the (i % W)-th bit of word[i / W] counting from its most significant bit
+    };
+
+    /**
+     * Non-owning packed view of BIT STRING bits in wire order, bit 0 is the leading bit of the first octet.
+     * Bits of the last octet beyond Size() are ignored.
+     */
+    class BitStringView {
+        OctetView octets_;
+        std::size_t size_{};
+
+        [[nodiscard]] Octet::value_type LastOctetMask() const noexcept {
+            return static_cast<Octet::value_type>(0xFF00 >> (size_ - 8 * (octets_.size() - 1)));
+        }
+
+    public:
+        static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+        BitStringView() = default;
+
+        /**
+         * @param octets packed bits, at least (size + 7) / 8 octets
+         */
+        BitStringView(OctetView octets, std::size_t size) : octets_(octets.substr(0, (size + 7) / 8)), size_(size) {
+            if (octets_.size() * 8 < size) {
+                throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+            }
+        }
+
+        [[nodiscard]] std::size_t Size() const noexcept {
+            return size_;
+        }
+
+        [[nodiscard]] OctetView Octets() const noexcept {
+            return octets_;
+        }
+
+        [[nodiscard]] std::size_t UnusedBits() const noexcept {
+            return octets_.size() * 8 - size_;
+        }
+
+        [[nodiscard]] bool Test(std::size_t i) const noexcept {
+            return (octets_[i / 8] >> (7 - i % 8)) & 1;
+        }
+
+        /**
+         * Number of set bits, 8 octets at a time.
+         */
+        [[nodiscard]] std::size_t Count() const noexcept {
+            if (size_ == 0) {
+                return 0;
+            }
+            const auto full = octets_.size() - 1;
+            std::size_t count = 0;
+            std::size_t i = 0;
+            for (; i + 8 <= full; i += 8) {
+                std::uint64_t word;
+                std::memcpy(&word, octets_.data() + i, sizeof(word));
+                count += PopCount64(word);
+            }
+            for (; i < full; ++i) {
+                count += std::popcount(static_cast<Octet::value_type>(octets_[i]));
+            }
+            return count + std::popcount(static_cast<Octet::value_type>(octets_[full] & LastOctetMask()));
+        }
+
+        /**
+         * Index of the first set bit at or after from, npos if there is none.
+         */
+        [[nodiscard]] std::size_t FindFirst(std::size_t from = 0) const noexcept {
+            if (from >= size_) {
+                return npos;
+            }
+            std::size_t i = from / 8;
+            auto head = static_cast<Octet::value_type>(octets_[i] & (0xFF >> (from % 8)));
+            std::size_t found = npos;
+            if (head != 0) {
+                found = 8 * i + std::countl_zero(head);
+            } else {
+                for (++i; i + 8 <= octets_.size(); i += 8) {
+                    const auto word = LoadBigEndian64(octets_.data() + i);
+                    if (word != 0) {
+                        found = 8 * i + std::countl_zero(word);
+                        break;
+                    }
+                }
+                for (; found == npos && i < octets_.size(); ++i) {
+                    if (octets_[i] != 0) {
+                        found = 8 * i + std::countl_zero(static_cast<Octet::value_type>(octets_[i]));
+                    }
+                }
+            }
+            return found < size_ ? found : npos;
+        }
+
+        [[nodiscard]] bool Any() const noexcept {
+            return FindFirst() != npos;
+        }
+
+        [[nodiscard]] bool None() const noexcept {
+            return !Any();
+        }
+
+        [[nodiscard]] bool All() const noexcept {
+            return Count() == size_;
+        }
+
+        /**
+         * Unpack into words, the whole words are written; surplus bits of the last one are zero.
+         * @return number of written words
+         */
+        template<class Word, typename = std::enable_if_t<std::is_unsigned_v<Word>>>
+        std::size_t CopyTo(std::span<Word> words, BitOrder order = BitOrder::Lsb0) const {
+            constexpr std::size_t word_bytes = sizeof(Word);
+            const auto count = (size_ + 8 * word_bytes - 1) / (8 * word_bytes);
+            if (words.size() < count) {
+                throw std::length_error{"Buffer is too small"};
+            }
+
+            for (std::size_t w = 0; w < count; ++w) {
+                const auto offset = w * word_bytes;
+                Octet chunk[sizeof(std::uint64_t)]{};
+                const auto take = std::min(word_bytes, octets_.size() - offset);
+                std::memcpy(chunk, octets_.data() + offset, take);
+                if (offset + take == octets_.size()) {
+                    chunk[take - 1] = static_cast<Octet::value_type>(chunk[take - 1] & LastOctetMask());
+                }
+
+                auto v = LoadBigEndian64(chunk); // first octet in the top byte
+                if (order == BitOrder::Lsb0) {
+                    v = ByteSwap(ReverseBitsInOctets(v)); // first octet in the low byte, bit 0 in bit 0
+                } else {
+                    v >>= 64 - 8 * word_bytes;
+                }
+                words[w] = static_cast<Word>(v);
+            }
+            return count;
+        }
+
+        friend bool operator==(const BitStringView &lhs, const BitStringView &rhs) noexcept {
+            if (lhs.size_ != rhs.size_) {
+                return false;
+            }
+            if (lhs.size_ == 0) {
+                return true;
+            }
+            const auto full = lhs.octets_.size() - 1;
+            return lhs.octets_.substr(0, full) == rhs.octets_.substr(0, full) &&
+                   (lhs.octets_[full] & lhs.LastOctetMask()) == (rhs.octets_[full] & rhs.LastOctetMask());
+        }
+    };
+
+    /**
+     * Owning BIT STRING, the result of decoding a constructed (segmented) encoding.
+     */
+    struct BitString {
+        OctetString octets;
+        std::size_t size{};
+
+        [[nodiscard]] BitStringView View() const {
+            return {{octets.data(), octets.size()}, size};
+        }
+    };
+
+    /**
+     * Bits packed in a caller's word buffer (bitmaps, bloom filters) to be encoded as BIT STRING.
+     */
+    template<class Word>
+    struct BitStringWords {
+        static_assert(std::is_unsigned_v<Word> && sizeof(Word) <= sizeof(std::uint64_t));
+
+        std::span<const Word> words;
+        std::size_t size; // in bits, at most 8 * sizeof(Word) * words.size()
+        BitOrder order = BitOrder::Lsb0;
+    };
+
+    namespace detail {
+        inline std::size_t BitStringContentSize(std::size_t bits) noexcept {
+            return 1 + (bits + 7) / 8;
+        }
+
+        template<class OutputIt>
+        OutputIt WriteBitStringHeader(std::size_t bits, OutputIt out) {
+            const auto content_sz = BitStringContentSize(bits);
+            Instrumentation::RecordEncoded(UniversalTagList::BIT_STRING, 1 + LengthSize(content_sz) + content_sz);
+            *out++ = IdentifierOctet{
+                    IdentifierOctet::Universal,
+                    IdentifierOctet::Constructed{false},
+                    IdentifierOctet::TagNumberType{UniversalTagList::BIT_STRING}
+            };
+            out = WriteLength(content_sz, out);
+            *out++ = Octet(static_cast<Octet::value_type>((8 - bits % 8) % 8));
+            return out;
+        }
+
+        /**
+         * Wire octets of a word: the first octet holds bits 0..7 with bit 0 as its leading bit.
+         */
+        template<class Word>
+        std::uint64_t WireOrderWord(Word word, BitOrder order) noexcept {
+            if (order == BitOrder::Lsb0) {
+                return ReverseBitsInOctets(ByteSwap(static_cast<std::uint64_t>(word)));
+            }
+            return static_cast<std::uint64_t>(word) << (64 - 8 * sizeof(Word));
+        }
+
+        inline void AppendBitStringSegments(const TlvView &tlv, BitString &result, bool &closed,
+                                            std::size_t depth = 0) {
+            if (!tlv.IsConstructed()) {
+                const auto content = tlv.Content();
+                if (closed) {
+                    throw std::logic_error{"Unused bits in a non-final segment"};
+                }
+                if (content.empty() || content[0] > 7 || (content.size() == 1 && content[0] != 0)) {
+                    throw std::logic_error{"Malformed BIT STRING"};
+                }
+                result.octets.append(content.begin() + 1, content.end());
+                result.size += 8 * (content.size() - 1) - content[0];
+                closed = content[0] != 0;
+                return;
+            }
+            if (depth == max_segment_depth) {
+                throw DecodeError{ErrorKind::Overflow, "Nesting is too deep"};
+            }
+            for (auto &&segment : tlv.Children()) {
+                if (!segment.IsUniversal(UniversalTagList::BIT_STRING)) {
+                    throw std::logic_error{"Wrong segment's tag"};
+                }
+                AppendBitStringSegments(segment, result, closed, depth + 1);
+            }
+        }
+    }
+
+    inline std::size_t EncodedSize(const BitStringView &bits) noexcept {
+        const auto content_sz = detail::BitStringContentSize(bits.Size());
+        return 1 + detail::LengthSize(content_sz) + content_sz;
+    }
+
+    template<class Word>
+    std::size_t EncodedSize(const BitStringWords<Word> &bits) noexcept {
+        const auto content_sz = detail::BitStringContentSize(bits.size);
+        return 1 + detail::LengthSize(content_sz) + content_sz;
+    }
+
+    /**
+     * Encode packed bits as is, unused bits of the last octet are cleared.
+     */
+    template<class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(const BitStringView &bits, OutputIt out) {
+        out = detail::WriteBitStringHeader(bits.Size(), out);
+        if (bits.Size() == 0) {
+            return out;
+        }
+        const auto octets = bits.Octets();
+        out = std::copy(octets.begin(), octets.end() - 1, out);
+        *out++ = Octet(static_cast<Octet::value_type>(octets.back() & (0xFF00 >> (8 - bits.UnusedBits()))));
+        return out;
+    }
+
+    /**
+     * Encode bits of a word buffer, a word at a time. Surplus bits of the last word are dropped.
+     */
+    template<class Word, class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(const BitStringWords<Word> &bits, OutputIt out) {
+        constexpr std::size_t word_bytes = sizeof(Word);
+        const auto octet_cnt = (bits.size + 7) / 8;
+        if (bits.words.size() * word_bytes < octet_cnt) {
+            throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+        }
+
+        out = detail::WriteBitStringHeader(bits.size, out);
+        if (octet_cnt == 0) {
+            return out;
+        }
+
+        const auto last = (octet_cnt - 1) / word_bytes;
+        for (std::size_t w = 0; w < last; ++w) {
+            Octet chunk[sizeof(std::uint64_t)];
+            StoreBigEndian64(chunk, detail::WireOrderWord(bits.words[w], bits.order));
+            if constexpr(std::is_pointer_v<OutputIt>) {
+                std::memcpy(out, chunk, word_bytes);
+                out += word_bytes;
+            } else {
+                out = std::copy(chunk, chunk + word_bytes, out);
+            }
+        }
+
+        // bits past the end of the string, including unused bits of the last octet, are cleared
+        const auto last_bits = bits.size - last * 8 * word_bytes;
+        Octet chunk[sizeof(std::uint64_t)];
+        const auto mask = ~std::uint64_t{0} << (64 - last_bits);
+        StoreBigEndian64(chunk, detail::WireOrderWord(bits.words[last], bits.order) & mask);
+        return std::copy(chunk, chunk + (octet_cnt - last * word_bytes), out);
+    }
+
+    inline EncodedBerObject Encode(const BitStringView &bits) {
+        EncodedBerObject result(EncodedSize(bits));
+        EncodeTo(bits, result.data());
+        return result;
+    }
+
+    template<class Word>
+    EncodedBerObject Encode(const BitStringWords<Word> &bits) {
+        EncodedBerObject result(EncodedSize(bits));
+        EncodeTo(bits, result.data());
+        return result;
+    }
+
+    /**
+     * View the bits of a primitive BIT STRING TLV spanning the whole input, nothing is copied.
+     */
+    inline BitStringView DecodeBitStringView(OctetView encoded) {
+        const auto header = ParseHeader(encoded);
+        if (header.identifier.ClassTag().value != IdentifierOctet::Universal.value ||
+            header.tag_number != UniversalTagList::BIT_STRING) {
+            throw std::logic_error{"Unexpected tag"};
+        }
+        if (header.identifier.IsConstructed()) {
+            throw DecodeError{ErrorKind::Unsupported, "Constructed string cannot be borrowed"};
+        }
+        if (header.length != encoded.size() - header.header_size) {
+            throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+        }
+        const auto content = encoded.substr(header.header_size);
+        if (content.empty() || content[0] > 7 || (content.size() == 1 && content[0] != 0)) {
+            throw std::logic_error{"Malformed BIT STRING"};
+        }
+        return {content.substr(1), 8 * (content.size() - 1) - content[0]};
+    }
+
+    /**
+     * Decode a primitive or constructed BIT STRING TLV, segments are concatenated.
+     */
+    inline BitString DecodeBitString(OctetView encoded) {
+        const TlvView tlv{encoded};
+        if (tlv.Bytes().size() != encoded.size()) {
+            throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+        }
+        BitString result;
+        bool closed = false;
+        detail::AppendBitStringSegments(tlv, result, closed);
+        return result;
+    }
+}
+
+#endif //BER_BITSTRING_H
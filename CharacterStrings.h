@@ -0,0 +1,412 @@
+#ifndef BER_CHARACTERSTRINGS_H
+#define BER_CHARACTERSTRINGS_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "EncodedBerObject.h"
+#include "Instrumentation.h"
+#include "HeaderParser.h"
+#include "TlvView.h"
+
+namespace BER {
+    /**
+     * Restricted character string value of type Tag. Decoded values borrow the encoded input.
+     */
+    template<UniversalTagList::Type Tag, class CharT = char>
+    struct RestrictedString {
+        static constexpr UniversalTagList::Type tag = Tag;
+        std::basic_string_view<CharT> value;
+
+        friend bool operator==(const RestrictedString &, const RestrictedString &) = default;
+    };
+
+    using Utf8String = RestrictedString<UniversalTagList::UTF8String>;
+    using PrintableString = RestrictedString<UniversalTagList::PrintableString>;
+    using IA5String = RestrictedString<UniversalTagList::IA5String>;
+    using NumericString = RestrictedString<UniversalTagList::NumericString>;
+    using VisibleString = RestrictedString<UniversalTagList::VisibleString>;
+    using BmpString = RestrictedString<UniversalTagList::BMPString, char16_t>;
+
+    /**
+     * BMPString contents as they are on the wire (big-endian UCS-2), code units are read on access.
+     */
+    class BmpStringView {
+        OctetView content_;
+
+    public:
+        BmpStringView() = default;
+
+        explicit BmpStringView(OctetView content) : content_(content) {}
+
+        [[nodiscard]] std::size_t size() const noexcept {
+            return content_.size() / 2;
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return content_.empty();
+        }
+
+        [[nodiscard]] char16_t operator[](std::size_t i) const noexcept {
+            return static_cast<char16_t>((content_[2 * i] << 8) | content_[2 * i + 1]);
+        }
+
+        [[nodiscard]] OctetView Bytes() const noexcept {
+            return content_;
+        }
+
+        [[nodiscard]] std::u16string ToU16String() const {
+            std::u16string result(size(), u'\0');
+            std::memcpy(result.data(), content_.data(), content_.size());
+            if constexpr(std::endian::native == std::endian::little) {
+                for (auto &&c : result) {
+                    c = static_cast<char16_t>((c >> 8) | (c << 8));
+                }
+            }
+            return result;
+        }
+    };
+
+    namespace detail {
+        using CharsetTable = std::array<bool, 256>;
+
+        template<class Pred>
+        constexpr CharsetTable MakeCharsetTable(Pred pred) {
+            CharsetTable table{};
+            for (int c = 0; c < 256; ++c) {
+                table[c] = pred(c);
+            }
+            return table;
+        }
+
+        inline constexpr CharsetTable ia5_charset = MakeCharsetTable([](int c) { return c < 0x80; });
+        inline constexpr CharsetTable visible_charset = MakeCharsetTable([](int c) { return c >= 0x20 && c < 0x7F; });
+        inline constexpr CharsetTable numeric_charset = MakeCharsetTable([](int c) {
+            return c == ' ' || (c >= '0' && c <= '9');
+        });
+        inline constexpr CharsetTable printable_charset = MakeCharsetTable([](int c) {
+            return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                   std::string_view{" '()+,-./:=?"}.find(static_cast<char>(c)) != std::string_view::npos;
+        });
+
+#if defined(__SSE2__)
+        /**
+         * Lanes of v within [lo, hi]: the bias moves the range to the bottom of the signed octet range.
+         */
+        inline __m128i InRange(__m128i v, std::uint8_t lo, std::uint8_t hi) noexcept {
+            const auto biased = _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(0x80 - lo)));
+            return _mm_cmplt_epi8(biased, _mm_set1_epi8(static_cast<char>(0x80 + (hi - lo + 1))));
+        }
+
+        /**
+         * Bit mask of the lanes holding a character outside the charset.
+         */
+        template<UniversalTagList::Type Tag>
+        int InvalidLanes(__m128i v) noexcept {
+            if constexpr(Tag == UniversalTagList::IA5String || Tag == UniversalTagList::UTF8String) {
+                return _mm_movemask_epi8(v);
+            } else if constexpr(Tag == UniversalTagList::VisibleString) {
+                return _mm_movemask_epi8(InRange(v, 0x20, 0x7E)) ^ 0xFFFF;
+            } else if constexpr(Tag == UniversalTagList::NumericString) {
+                const auto ok = _mm_or_si128(InRange(v, '0', '9'), _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+                return _mm_movemask_epi8(ok) ^ 0xFFFF;
+            } else {
+                static_assert(Tag == UniversalTagList::PrintableString);
+                auto ok = InRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+                ok = _mm_or_si128(ok, InRange(v, '\'', ')'));
+                ok = _mm_or_si128(ok, InRange(v, '+', ':')); // + , - . / and digits
+                ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+                ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('=')));
+                ok = _mm_or_si128(ok, _mm_cmpeq_epi8(v, _mm_set1_epi8('?')));
+                return _mm_movemask_epi8(ok) ^ 0xFFFF;
+            }
+        }
+#endif
+
+        template<UniversalTagList::Type Tag>
+        constexpr const CharsetTable &Charset() noexcept {
+            if constexpr(Tag == UniversalTagList::IA5String || Tag == UniversalTagList::UTF8String) {
+                return ia5_charset;
+            } else if constexpr(Tag == UniversalTagList::VisibleString) {
+                return visible_charset;
+            } else if constexpr(Tag == UniversalTagList::NumericString) {
+                return numeric_charset;
+            } else {
+                return printable_charset;
+            }
+        }
+
+        /**
+         * Length of the longest prefix within the charset of Tag (ASCII for UTF8String),
+         * 32 octets per step with SSE2, 8 per step for the ASCII check without it.
+         */
+        template<UniversalTagList::Type Tag>
+        std::size_t CharsetPrefix(const Octet *data, std::size_t size) noexcept {
+            std::size_t i = 0;
+#if defined(__SSE2__)
+            for (; i + 32 <= size; i += 32) {
+                const auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+                const auto hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + 16));
+                const auto bad = static_cast<unsigned>(InvalidLanes<Tag>(lo)) |
+                                 (static_cast<unsigned>(InvalidLanes<Tag>(hi)) << 16);
+                if (bad != 0) {
+                    return i + std::countr_zero(bad);
+                }
+            }
+            for (; i + 16 <= size; i += 16) {
+                const auto bad = static_cast<unsigned>(
+                        InvalidLanes<Tag>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i))));
+                if (bad != 0) {
+                    return i + std::countr_zero(bad);
+                }
+            }
+#else
+            if constexpr(Tag == UniversalTagList::IA5String || Tag == UniversalTagList::UTF8String) {
+                for (; i + 8 <= size; i += 8) {
+                    std::uint64_t word;
+                    std::memcpy(&word, data + i, sizeof(word));
+                    if ((word & 0x8080808080808080ull) != 0) {
+                        break;
+                    }
+                }
+            }
+#endif
+            const auto &charset = Charset<Tag>();
+            while (i < size && charset[data[i]]) {
+                ++i;
+            }
+            return i;
+        }
+
+        /**
+         * Length of a well-formed UTF-8 sequence at data (Unicode table 3-7), 0 if ill-formed.
+         */
+        constexpr std::size_t Utf8SequenceSize(const Octet *data, std::size_t size) noexcept {
+            const unsigned c = data[0];
+            std::size_t len;
+            unsigned lo = 0x80;
+            unsigned hi = 0xBF;
+            if (c < 0x80) {
+                return 1;
+            } else if (c >= 0xC2 && c <= 0xDF) {
+                len = 2;
+            } else if (c >= 0xE0 && c <= 0xEF) {
+                len = 3;
+                lo = c == 0xE0 ? 0xA0 : 0x80; // overlong
+                hi = c == 0xED ? 0x9F : 0xBF; // surrogates
+            } else if (c >= 0xF0 && c <= 0xF4) {
+                len = 4;
+                lo = c == 0xF0 ? 0x90 : 0x80; // overlong
+                hi = c == 0xF4 ? 0x8F : 0xBF; // above U+10FFFF
+            } else {
+                return 0;
+            }
+            if (size < len || data[1] < lo || data[1] > hi) {
+                return 0;
+            }
+            for (std::size_t i = 2; i < len; ++i) {
+                if ((data[i] & 0xC0) != 0x80) {
+                    return 0;
+                }
+            }
+            return len;
+        }
+
+        inline bool IsValidUtf8(OctetView content) noexcept {
+            const Octet *data = content.data();
+            const Octet *const end = data + content.size();
+            while (data != end) {
+                if (*data < 0x80) {
+                    data += CharsetPrefix<UniversalTagList::UTF8String>(data, end - data);
+                    continue;
+                }
+                // Non-ASCII text tends to come in runs, stay on the scalar path until the next ASCII octet.
+                do {
+                    const auto len = Utf8SequenceSize(data, end - data);
+                    if (len == 0) {
+                        return false;
+                    }
+                    data += len;
+                } while (data != end && *data >= 0x80);
+            }
+            return true;
+        }
+
+        /**
+         * UCS-2 big-endian code units, surrogates are not characters of the BMP.
+         */
+        inline bool IsValidBmp(OctetView content) noexcept {
+            if (content.size() % 2 != 0) {
+                return false;
+            }
+            std::size_t i = 0;
+#if defined(__SSE2__)
+            for (; i + 16 <= content.size(); i += 16) {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(content.data() + i));
+                const auto high = _mm_and_si128(v, _mm_set1_epi8(static_cast<char>(0xF8)));
+                if ((_mm_movemask_epi8(_mm_cmpeq_epi8(high, _mm_set1_epi8(static_cast<char>(0xD8)))) & 0x5555) != 0) {
+                    return false;
+                }
+            }
+#endif
+            for (; i < content.size(); i += 2) {
+                if ((content[i] & 0xF8) == 0xD8) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        template<UniversalTagList::Type Tag>
+        bool IsValidContent(OctetView content) noexcept {
+            if constexpr(Tag == UniversalTagList::UTF8String) {
+                return IsValidUtf8(content);
+            } else if constexpr(Tag == UniversalTagList::BMPString) {
+                return IsValidBmp(content);
+            } else {
+                return CharsetPrefix<Tag>(content.data(), content.size()) == content.size();
+            }
+        }
+
+        template<class T>
+        inline constexpr bool IsRestrictedString = false;
+
+        template<UniversalTagList::Type Tag, class CharT>
+        inline constexpr bool IsRestrictedString<RestrictedString<Tag, CharT>> = true;
+
+        /**
+         * Contents of a primitive string TLV of type Tag spanning the whole view.
+         */
+        inline OctetView BorrowedStringContent(OctetView encoded, UniversalTagList::Type tag) {
+            const auto header = ParseHeader(encoded);
+            if (header.identifier.ClassTag().value != IdentifierOctet::Universal.value || header.tag_number != tag) {
+                throw std::logic_error{"Unexpected tag"};
+            }
+            if (header.identifier.IsConstructed()) {
+                throw DecodeError{ErrorKind::Unsupported, "Constructed string cannot be borrowed"};
+            }
+            if (header.length != encoded.size() - header.header_size) {
+                throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+            }
+            return encoded.substr(header.header_size);
+        }
+    }
+
+    /**
+     * Check contents octets of a character string type, UTF8String is checked for well-formed UTF-8.
+     * Types without a restricted charset are always valid.
+     */
+    inline bool IsValidCharacterString(UniversalTagList::Type tag, OctetView content) noexcept {
+        switch (tag) {
+            case UniversalTagList::UTF8String:
+                return detail::IsValidContent<UniversalTagList::UTF8String>(content);
+            case UniversalTagList::PrintableString:
+                return detail::IsValidContent<UniversalTagList::PrintableString>(content);
+            case UniversalTagList::IA5String:
+                return detail::IsValidContent<UniversalTagList::IA5String>(content);
+            case UniversalTagList::NumericString:
+                return detail::IsValidContent<UniversalTagList::NumericString>(content);
+            case UniversalTagList::VisibleString:
+                return detail::IsValidContent<UniversalTagList::VisibleString>(content);
+            case UniversalTagList::BMPString:
+                return detail::IsValidContent<UniversalTagList::BMPString>(content);
+            default:
+                return true;
+        }
+    }
+
+    template<UniversalTagList::Type Tag, class CharT>
+    std::size_t EncodedSize(const RestrictedString<Tag, CharT> &str) noexcept {
+        const auto content_sz = str.value.size() * sizeof(CharT);
+        return 1 + detail::LengthSize(content_sz) + content_sz;
+    }
+
+    /**
+     * Encode a character string, its characters are checked against the type's charset.
+     * @throws std::logic_error on a character outside the charset
+     */
+    template<UniversalTagList::Type Tag, class CharT, class OutputIt,
+            typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(const RestrictedString<Tag, CharT> &str, OutputIt out) {
+        const auto content_sz = str.value.size() * sizeof(CharT);
+        if constexpr(std::is_same_v<CharT, char16_t>) {
+            for (auto c : str.value) {
+                if ((c & 0xF800) == 0xD800) {
+                    throw std::logic_error{"Invalid character"};
+                }
+            }
+        } else if (!detail::IsValidContent<Tag>(AsOctetView(str.value))) {
+            throw std::logic_error{"Invalid character"};
+        }
+
+        Instrumentation::RecordEncoded(Tag, 1 + detail::LengthSize(content_sz) + content_sz);
+        *out++ = IdentifierOctet{
+                IdentifierOctet::Universal,
+                IdentifierOctet::Constructed{false},
+                IdentifierOctet::TagNumberType{Tag}
+        };
+        out = detail::WriteLength(content_sz, out);
+
+        if constexpr(std::is_same_v<CharT, char16_t>) {
+            for (auto c : str.value) {
+                *out++ = Octet(static_cast<Octet::value_type>(c >> 8));
+                *out++ = Octet(static_cast<Octet::value_type>(c));
+            }
+            return out;
+        } else if constexpr(std::is_pointer_v<OutputIt>) {
+            std::memcpy(out, str.value.data(), content_sz);
+            return out + content_sz;
+        } else {
+            const auto octets = AsOctetView(str.value);
+            return std::copy(octets.begin(), octets.end(), out);
+        }
+    }
+
+    template<UniversalTagList::Type Tag, class CharT>
+    EncodedBerObject Encode(const RestrictedString<Tag, CharT> &str) {
+        EncodedBerObject result(EncodedSize(str));
+        EncodeTo(str, result.data());
+        return result;
+    }
+
+    /**
+     * Decode a primitive character string TLV of type S without copying, S::value refers to encoded.
+     * Constructed (segmented) strings are rejected, Decode() concatenates them into an owned string.
+     */
+    template<class S, typename = std::enable_if_t<detail::IsRestrictedString<S> &&
+                                                  std::is_same_v<typename decltype(S::value)::value_type, char>>>
+    S DecodeStringView(OctetView encoded) {
+        const auto content = detail::BorrowedStringContent(encoded, S::tag);
+        if (!detail::IsValidContent<S::tag>(content)) {
+            throw std::logic_error{"Invalid character"};
+        }
+        return S{{reinterpret_cast<const char *>(content.data()), content.size()}};
+    }
+
+    /**
+     * Decode a primitive BMPString TLV without copying.
+     */
+    inline BmpStringView DecodeBmpStringView(OctetView encoded) {
+        const auto content = detail::BorrowedStringContent(encoded, UniversalTagList::BMPString);
+        if (!detail::IsValidBmp(content)) {
+            throw std::logic_error{"Invalid character"};
+        }
+        return BmpStringView{content};
+    }
+}
+
+#endif //BER_CHARACTERSTRINGS_H
@@ -3,49 +3,53 @@
 
 #include <cstdint>
 #include <type_traits>
-#include <typeindex>
-#include <memory_resource>
 #include <stdexcept>
 #include <optional>
-#include <stdexcept>
-#include <unordered_map>
-#include <functional>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
 #include <iterator>
-#include <cassert>
+#include <limits>
+#include <string>
+#include <utility>
+#include <variant>
 
 #include "Octet.h"
 #include "OctetClasses.h"
+#include "EncodedBerObject.h"
+#include "Instrumentation.h"
+#include "HeaderParser.h"
+#include "TlvView.h"
+#include "ObjectIdentifier.h"
+#include "CharacterStrings.h"
+#include "BitString.h"
+#include "Time.h"
 
 namespace BER {
     using IntType = std::intmax_t;
 
-    class DecodedBerObject {
-        std::type_index type_info_;
-        std::pmr::memory_resource *resource_;
-        int type_sz_{};
-        void *data_{};
-
-        template<class T>
-        static T &cast_impl(void *d) noexcept {
-            return *static_cast<T *>(d);
-        }
+    namespace detail {
+        template<class T, class Variant>
+        inline constexpr bool is_alternative_of = false;
 
-        template<class T>
-        static T &cast_impl(const void *d) noexcept {
-            return *static_cast<const T *>(d);
-        }
+        template<class T, class... Ts>
+        inline constexpr bool is_alternative_of<T, std::variant<Ts...>> = (std::is_same_v<T, Ts> || ...);
+    }
 
-        struct RAIIPointer {
-            void *data;
-            std::size_t sz;
-            std::pmr::memory_resource *resource;
+    /**
+     * Decoded universal value, one of a closed set of types held inline: scalars and times never allocate,
+     * strings only when they do not fit their small-string buffer. Type checks compare the variant's index.
+     */
+    class DecodedBerObject {
+    public:
+        using Value = std::variant<std::nullptr_t, bool, IntType, double, OctetString, std::string,
+                                   std::u16string, std::u32string, BitString, ObjectIdentifier, RelativeOid,
+                                   UtcTime, GeneralizedTime>;
 
-            ~RAIIPointer() {
-                if (data != nullptr) {
-                    resource->deallocate(data, sz);
-                }
-            }
-        };
+    private:
+        Value value_;
 
     public:
         struct BerCastError : std::runtime_error {
@@ -54,108 +58,443 @@ namespace BER {
 
         DecodedBerObject() = delete;
 
+        template<class T, typename = std::enable_if_t<detail::is_alternative_of<std::decay_t<T>, Value>>>
+        explicit DecodedBerObject(T &&t) : value_(std::in_place_type<std::decay_t<T>>, std::forward<T>(t)) {}
+
+        DecodedBerObject(const DecodedBerObject &) = default;
+
+        DecodedBerObject(DecodedBerObject &&) noexcept = default;
+
+        DecodedBerObject &operator=(const DecodedBerObject &) = default;
+
+        DecodedBerObject &operator=(DecodedBerObject &&) noexcept = default;
+
         template<class T>
-        explicit
-        DecodedBerObject(T &&t, std::pmr::memory_resource *resource = std::pmr::get_default_resource()) : resource_(
-                resource),
-                                                                                                          type_info_(
-                                                                                                                  typeid(T)) {
-            RAIIPointer p{resource_->allocate(sizeof(T), alignof(T)),
-                          sizeof(T),
-                          resource_};
+        [[nodiscard]] bool holds() const noexcept {
+            if constexpr(detail::is_alternative_of<T, Value>) {
+                return std::holds_alternative<T>(value_);
+            } else {
+                return false;
+            }
+        }
 
-            cast_impl<std::decay_t<T>>(p.data) = std::forward<T>(t);
-            std::swap(data_, p.data);
-            type_sz_ = sizeof(T);
+        /**
+         * Copy of the value, nullopt if it is not a T.
+         */
+        template<class T>
+        std::optional<T> cast() const {
+            if constexpr(detail::is_alternative_of<T, Value>) {
+                if (const auto *p = std::get_if<T>(&value_)) {
+                    return *p;
+                }
+            }
+            return std::nullopt;
         }
 
+        /**
+         * @throws BerCastError if the value is not a T
+         */
         template<class T>
-        std::optional<T> cast() {
-            if (std::type_index{typeid(T)} != type_info_) {
-                return std::nullopt;
-            } else {
-                return std::optional<T>{cast_impl<T>(data_)};
+        [[nodiscard]] const T &get() const {
+            static_assert(detail::is_alternative_of<T, Value>, "T is not a decoded type");
+            if (const auto *p = std::get_if<T>(&value_)) {
+                return *p;
             }
+            throw BerCastError{"Decoded value has another type"};
         }
 
-        ~DecodedBerObject() {
-            resource_->deallocate(data_, type_sz_);
+        [[nodiscard]] const Value &value() const noexcept {
+            return value_;
         }
     };
 
     namespace detail {
-        IntType DecodeIntegralImpl(OctetView encoded) {
-            IntType result = 0;
-            bool neg = false;
+        using DecoderFn = DecodedBerObject (*)(OctetView);
 
-            if (encoded[0].SubBits<7, 7>() == 1) {
-                neg = true;
+        inline void AppendStringSegments(const TlvView &tlv, OctetString &result, std::size_t depth = 0) {
+            if (!tlv.IsConstructed()) {
+                const auto content = tlv.Content();
+                result.append(content.begin(), content.end());
+                return;
             }
-
-            for (int i = 0; i < encoded.size() && (result <<= 8, 1); ++i) {
-                result += (neg ? ~encoded[i].SubBits<7, 0>() : encoded[i].SubBits<7, 0>());
+            if (depth == max_segment_depth) {
+                throw DecodeError{ErrorKind::Overflow, "Nesting is too deep"};
             }
+            for (auto &&segment : tlv.Children()) {
+                if (segment.TagNumber() != tlv.TagNumber()) {
+                    throw std::logic_error{"Wrong segment's tag"};
+                }
+                AppendStringSegments(segment, result, depth + 1);
+            }
+        }
 
-            if (neg) {
-                ++result;
-                result *= -1;
+        /**
+         * Contents of a string type TLV, segments of the constructed encoding are concatenated.
+         */
+        inline OctetString StringContent(OctetView encoded) {
+            const TlvView tlv{encoded};
+            if (tlv.Bytes().size() != encoded.size()) {
+                throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
             }
 
+            OctetString result;
+            AppendStringSegments(tlv, result);
             return result;
         }
 
-        DecodedBerObject DecodeIntegral(OctetView encoded) {
-            assert(!encoded.empty() && IdentifierOctet{encoded[0]}.TagNumber().value == UniversalTagList::INTEGER);
+        inline IntType DecodeIntegralImpl(OctetView content) {
+            if (content.empty()) {
+                throw std::logic_error{"Empty integer"};
+            }
+            if (content.size() > sizeof(IntType)) {
+                throw DecodeError{ErrorKind::Overflow, "Integer overflow"};
+            }
+
+            std::uintmax_t result = content[0].SubBits<7, 7>() == 1 ? ~std::uintmax_t{0} : 0;
+            for (auto &&el : content) {
+                result = (result << 8) | el;
+            }
 
-            IntType result = 0;
-            bool neg = false;
+            return static_cast<IntType>(result);
+        }
+
+        inline DecodedBerObject DecodeIntegral(OctetView encoded) {
+            return DecodedBerObject{DecodeIntegralImpl(PrimitiveContent(encoded))};
+        }
 
-            encoded.remove_prefix(1);
-            LengthOctet length{encoded.front()};
-            encoded.remove_prefix(1);
-            assert(length.IsShort());
-            if (length.Data() != encoded.size())  {
-                throw std::logic_error{"Sizes' mismatch"};
+        inline DecodedBerObject DecodeBoolean(OctetView encoded) {
+            const auto content = PrimitiveContent(encoded);
+            if (content.size() != 1) {
+                throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
             }
+            return DecodedBerObject{content[0] != 0};
+        }
 
-            if (encoded[0].SubBits<7, 7>() == 1) {
-                neg = true;
+        inline DecodedBerObject DecodeNull(OctetView encoded) {
+            if (!PrimitiveContent(encoded).empty()) {
+                throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
             }
+            return DecodedBerObject{nullptr};
+        }
+
+        inline DecodedBerObject DecodeOctetString(OctetView encoded) {
+            return DecodedBerObject{StringContent(encoded)};
+        }
 
-            for (int i = 0; i < length.Data() && (result <<= 8, 1); ++i) {
-                result += (neg ? ~encoded[i].SubBits<7, 0>() : encoded[i].SubBits<7, 0>());
+        inline DecodedBerObject DecodeBitStringObject(OctetView encoded) {
+            return DecodedBerObject{DecodeBitString(encoded)};
+        }
+
+        /**
+         * Correctly rounded (to nearest, ties to even) mantissa * 2^exponent.
+         * The mantissa is rounded once to the precision available at the result's exponent,
+         * including subnormals, after that ldexp is exact.
+         * @param sticky non-zero bits were dropped below the mantissa
+         */
+        inline double ComposeDouble(std::uint64_t mantissa, bool sticky, IntType exponent) {
+            if (mantissa == 0) {
+                return 0.;
             }
 
-            if (neg) {
-                ++result;
-                result *= -1;
+            constexpr int digits = std::numeric_limits<double>::digits;
+            constexpr int min_exp = std::numeric_limits<double>::min_exponent - 1;
+
+            const int width = std::bit_width(mantissa);
+            const IntType leading_exp = exponent + width - 1;
+            IntType precision = digits;
+            if (leading_exp < min_exp) {
+                precision -= min_exp - leading_exp;
             }
-            return DecodedBerObject{result};
+
+            const IntType shift = width - precision;
+            if (shift > 0) {
+                if (shift > 64) {
+                    mantissa = 0;
+                } else {
+                    const std::uint64_t rem = shift == 64 ? mantissa : mantissa & ((std::uint64_t{1} << shift) - 1);
+                    const std::uint64_t half = std::uint64_t{1} << (shift - 1);
+                    mantissa = shift == 64 ? 0 : mantissa >> shift;
+                    if (rem > half || (rem == half && (sticky || (mantissa & 1) != 0))) {
+                        ++mantissa;
+                    }
+                }
+                exponent += shift;
+            }
+
+            constexpr IntType exp_limit = 4 * std::numeric_limits<double>::max_exponent;
+            exponent = std::clamp<IntType>(exponent, -exp_limit, exp_limit);
+            return std::ldexp(static_cast<double>(mantissa), static_cast<int>(exponent));
         }
 
-        inline const std::unordered_map<UniversalTagList::Type, std::function<DecodedBerObject(
-                OctetView)>> decoders_map = {
-                {UniversalTagList::INTEGER, DecodeIntegral}
-        };
-    }
+        inline double DecodeRealImpl(OctetView content) {
+            if (content.empty()) {
+                return 0.;
+            }
+
+            const Octet info_octet = content[0];
+            content.remove_prefix(1);
+
+            if (info_octet.SubBits<7, 7>() == 1) {
+                const bool negative = info_octet.SubBits<6, 6>() == 1;
+                static constexpr int base_log2[] = {1, 3, 4, 0};
+                const int base_bits = base_log2[info_octet.SubBits<5, 4>().value];
+                const int scale = info_octet.SubBits<3, 2>().value;
+                if (base_bits == 0) {
+                    throw std::logic_error{"Reserved REAL base"};
+                }
+
+                std::size_t exp_sz = info_octet.SubBits<1, 0>().value + 1;
+                if (exp_sz == 4) {
+                    if (content.empty()) {
+                        throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+                    }
+                    exp_sz = content[0];
+                    content.remove_prefix(1);
+                }
+                if (exp_sz == 0 || exp_sz > content.size()) {
+                    throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+                }
+                if (exp_sz > sizeof(std::int32_t)) {
+                    throw DecodeError{ErrorKind::Overflow, "Integer overflow"};
+                }
+
+                const auto exponent = DecodeIntegralImpl(content.substr(0, exp_sz));
+                content.remove_prefix(exp_sz);
 
-    DecodedBerObject Decode(OctetView view) {
-        if (view.empty()) {
-            throw std::logic_error{"Empty octet stream"};
+                while (!content.empty() && content[0] == 0) {
+                    content.remove_prefix(1);
+                }
+                // octets beyond 64 bits of mantissa only matter for rounding
+                bool sticky = false;
+                IntType extra_bits = 0;
+                if (content.size() > sizeof(std::uint64_t)) {
+                    const auto tail = content.substr(sizeof(std::uint64_t));
+                    sticky = std::any_of(tail.begin(), tail.end(), [](Octet el) { return el != 0; });
+                    extra_bits = 8 * static_cast<IntType>(tail.size());
+                    content = content.substr(0, sizeof(std::uint64_t));
+                }
+
+                std::uint64_t mantissa = 0;
+                for (auto &&el : content) {
+                    mantissa = (mantissa << 8) | el;
+                }
+
+                const double result = ComposeDouble(mantissa, sticky, exponent * base_bits + scale + extra_bits);
+                return negative ? -result : result;
+            }
+
+            if (info_octet.SubBits<6, 6>() == 1) {
+                if (!content.empty()) {
+                    throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+                }
+                switch (info_octet) {
+                    case 0x40:
+                        return std::numeric_limits<double>::infinity();
+                    case 0x41:
+                        return -std::numeric_limits<double>::infinity();
+                    case 0x42:
+                        return std::numeric_limits<double>::quiet_NaN();
+                    case 0x43:
+                        return -0.;
+                    default:
+                        throw std::logic_error{"Reserved REAL special value"};
+                }
+            }
+
+            // ISO 6093 decimal forms
+            char buf[64];
+            if (content.size() >= sizeof(buf)) {
+                throw DecodeError{ErrorKind::Overflow, "Decimal REAL is too long"};
+            }
+            std::size_t len = 0;
+            for (auto &&el : content) {
+                if (el != ' ' || len != 0) {
+                    buf[len++] = el == ',' ? '.' : static_cast<char>(el.octet_);
+                }
+            }
+            const char *first = buf;
+            if (len != 0 && *first == '+') {
+                ++first;
+            }
+
+            double result;
+            const auto[ptr, ec] = std::from_chars(first, buf + len, result);
+            if (ec != std::errc{} || ptr != buf + len) {
+                throw std::logic_error{"Malformed decimal REAL"};
+            }
+            return result;
+        }
+
+        inline DecodedBerObject DecodeReal(OctetView encoded) {
+            return DecodedBerObject{DecodeRealImpl(PrimitiveContent(encoded))};
+        }
+
+        inline DecodedBerObject DecodeObjectIdentifier(OctetView encoded) {
+            return DecodedBerObject{DecodeObjectIdentifierContent(PrimitiveContent(encoded))};
+        }
+
+        inline DecodedBerObject DecodeRelativeOid(OctetView encoded) {
+            return DecodedBerObject{DecodeRelativeOidContent(PrimitiveContent(encoded))};
+        }
+
+        inline DecodedBerObject DecodeCharacterString(OctetView encoded) {
+            const auto content = StringContent(encoded);
+            return DecodedBerObject{std::string(content.begin(), content.end())};
+        }
+
+        /**
+         * Character string with a restricted charset (or UTF-8), checked before it is copied out.
+         */
+        template<UniversalTagList::Type Tag>
+        DecodedBerObject DecodeRestrictedString(OctetView encoded) {
+            const auto content = StringContent(encoded);
+            if (!IsValidContent<Tag>(content)) {
+                throw std::logic_error{"Invalid character"};
+            }
+            return DecodedBerObject{std::string(content.begin(), content.end())};
         }
 
-        IdentifierOctet id_octet{view[0]};
+        inline DecodedBerObject DecodeUtcTimeObject(OctetView encoded) {
+            return DecodedBerObject{ParseUtcTime(StringContent(encoded))};
+        }
+
+        inline DecodedBerObject DecodeGeneralizedTimeObject(OctetView encoded) {
+            return DecodedBerObject{ParseGeneralizedTime(StringContent(encoded))};
+        }
+
+        template<class Char>
+        DecodedBerObject DecodeWideString(OctetView encoded) {
+            const auto content = StringContent(encoded);
+            if (content.size() % sizeof(Char) != 0) {
+                throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+            }
+            if constexpr(std::is_same_v<Char, char16_t>) {
+                if (!IsValidBmp(content)) {
+                    throw std::logic_error{"Invalid character"};
+                }
+            }
 
-        if (id_octet.ClassTag().value != IdentifierOctet::Universal.value) {
-            throw std::logic_error{"Universal is only supported"};
+            std::basic_string<Char> result(content.size() / sizeof(Char), Char{});
+            for (std::size_t i = 0; i < content.size(); ++i) {
+                result[i / sizeof(Char)] = (result[i / sizeof(Char)] << 8) | content[i];
+            }
+            return DecodedBerObject{std::move(result)};
         }
 
-        return detail::decoders_map.at(static_cast<UniversalTagList::Type>(id_octet.TagNumber().value))(view);
+        inline DecodedBerObject DecodeUnsupported(OctetView) {
+            throw DecodeError{ErrorKind::Unsupported, "Unsupported tag"};
+        }
+
+        template<UniversalTagList::Type Tag>
+        inline constexpr DecoderFn decoder_for = DecodeUnsupported;
+
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::BOOLEAN> = DecodeBoolean;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::INTEGER> = DecodeIntegral;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::BIT_STRING> = DecodeBitStringObject;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::OCTET_STRING> = DecodeOctetString;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::NULL_TYPE> = DecodeNull;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::OBJECT_IDENTIFIER> = DecodeObjectIdentifier;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::ObjectDescriptor> = DecodeCharacterString;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::REAL> = DecodeReal;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::ENUMERATED> = DecodeIntegral;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::UTF8String> =
+                DecodeRestrictedString<UniversalTagList::UTF8String>;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::RELATIVE_OID> = DecodeRelativeOid;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::NumericString> =
+                DecodeRestrictedString<UniversalTagList::NumericString>;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::PrintableString> =
+                DecodeRestrictedString<UniversalTagList::PrintableString>;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::T61String> = DecodeCharacterString;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::VideotexString> = DecodeCharacterString;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::IA5String> =
+                DecodeRestrictedString<UniversalTagList::IA5String>;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::UTCTime> = DecodeUtcTimeObject;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::GeneralizedTime> = DecodeGeneralizedTimeObject;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::GraphicString> = DecodeCharacterString;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::VisibleString> =
+                DecodeRestrictedString<UniversalTagList::VisibleString>;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::GeneralString> = DecodeCharacterString;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::UniversalString> = DecodeWideString<char32_t>;
+        template<>
+        inline constexpr DecoderFn decoder_for<UniversalTagList::BMPString> = DecodeWideString<char16_t>;
+
+        template<std::size_t... Tags>
+        constexpr std::array<DecoderFn, sizeof...(Tags)> MakeDecodersTable(std::index_sequence<Tags...>) {
+            return {decoder_for<static_cast<UniversalTagList::Type>(Tags)>...};
+        }
+
+        /**
+         * Indexed by the 5-bit tag number of the leading identifier octet, 31 (high tag number) is unsupported.
+         */
+        inline constexpr auto decoders_table = MakeDecodersTable(std::make_index_sequence<32>{});
     }
 
-    DecodedBerObject Decode(const EncodedBerObject &encoded) {
+    inline DecodedBerObject Decode(OctetView view) {
+        return Instrumentation::Guard([&] {
+            if (view.empty()) {
+                throw DecodeError{ErrorKind::Truncated, "Empty octet stream"};
+            }
+
+            IdentifierOctet id_octet{view[0]};
+
+            if (id_octet.ClassTag().value != IdentifierOctet::Universal.value) {
+                throw DecodeError{ErrorKind::Unsupported, "Universal is only supported"};
+            }
+
+            if constexpr(Instrumentation::enabled) {
+                TlvHeader header;
+                if (TryParseHeader(view, header) == HeaderError::None) {
+                    detail::RecordDecodedTlv(header, view.size());
+                }
+            }
+            return detail::decoders_table[id_octet.TagNumber().value](view);
+        });
+    }
+
+    inline DecodedBerObject Decode(const EncodedBerObject &encoded) {
         return Decode(OctetView(&encoded.front(), encoded.size()));
     }
+
+    inline DecodedBerObject Decode(const TlvView &tlv) {
+        return Decode(tlv.Bytes());
+    }
+
+    /**
+     * Decode a byte buffer in place, see AsOctetView().
+     */
+    inline DecodedBerObject Decode(std::span<const std::byte> bytes) {
+        return Decode(AsOctetView(bytes));
+    }
+
+    inline DecodedBerObject Decode(std::string_view str) {
+        return Decode(AsOctetView(str));
+    }
+
+    inline DecodedBerObject Decode(const unsigned char *data, std::size_t size) {
+        return Decode(AsOctetView(data, size));
+    }
 }
 
 
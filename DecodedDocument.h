@@ -0,0 +1,173 @@
+#ifndef BER_DECODEDDOCUMENT_H
+#define BER_DECODEDDOCUMENT_H
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Instrumentation.h"
+#include "HeaderParser.h"
+#include "TlvView.h"
+#include "EncodedBerObject.h"
+#include "DecodedBerObject.h"
+
+namespace BER {
+    /**
+     * Node of a decoded TLV tree. Trivially destructible, lives in the document's arena.
+     */
+    struct DecodedNode {
+        TlvHeader header;
+        OctetView bytes;
+        const DecodedNode *children{};
+        std::size_t children_count{};
+
+        [[nodiscard]] bool IsConstructed() const noexcept {
+            return header.identifier.IsConstructed();
+        }
+
+        [[nodiscard]] bool IsUniversal(UniversalTagList::Type tag) const noexcept {
+            return header.identifier.ClassTag().value == IdentifierOctet::Universal.value && header.tag_number == tag;
+        }
+
+        [[nodiscard]] OctetView Content() const noexcept {
+            const auto content = bytes.substr(header.header_size);
+            return header.indefinite ? content.substr(0, content.size() - 2) : content;
+        }
+
+        [[nodiscard]] std::string_view String() const noexcept {
+            const auto content = Content();
+            return {reinterpret_cast<const char *>(content.data()), content.size()};
+        }
+
+        [[nodiscard]] std::span<const DecodedNode> Children() const noexcept {
+            return {children, children_count};
+        }
+
+        [[nodiscard]] DecodedBerObject Decode() const {
+            return BER::Decode(bytes);
+        }
+    };
+
+    /**
+     * Monotonic arena for decoded documents. Release() returns to the initial buffer,
+     * so a reused arena does not touch the upstream resource for messages that fit into it.
+     */
+    class DocumentArena {
+        std::unique_ptr<std::byte[]> buffer_;
+        std::pmr::monotonic_buffer_resource resource_;
+
+    public:
+        explicit DocumentArena(std::size_t initial_size = 64 * 1024,
+                               std::pmr::memory_resource *upstream = std::pmr::get_default_resource()) :
+                buffer_(new std::byte[initial_size]),
+                resource_(buffer_.get(), initial_size, upstream) {}
+
+        DocumentArena(const DocumentArena &) = delete;
+
+        DocumentArena &operator=(const DocumentArena &) = delete;
+
+        [[nodiscard]] std::pmr::memory_resource *Resource() noexcept {
+            return &resource_;
+        }
+
+        void Release() {
+            resource_.release();
+        }
+
+        static DocumentArena &ThreadLocal() {
+            thread_local DocumentArena arena;
+            return arena;
+        }
+    };
+
+    /**
+     * Decoded tree of a (possibly constructed) TLV. Nodes, children arrays and, unless borrowed,
+     * a copy of the input are allocated from one arena; the document itself owns nothing,
+     * so dropping it is free and the memory goes away with the arena.
+     */
+    class DecodedDocument {
+        static constexpr std::size_t max_depth = 256;
+
+        std::pmr::memory_resource *resource_;
+        OctetView bytes_;
+        const DecodedNode *root_{};
+
+        void Build(DecodedNode &node, const TlvView &tlv, std::size_t depth) {
+            node.header = tlv.Header();
+            node.bytes = tlv.Bytes();
+            detail::RecordDecodedTlv(node.header, node.bytes.size());
+
+            if (!tlv.IsConstructed()) {
+                return;
+            }
+            if (depth == max_depth) {
+                throw DecodeError{ErrorKind::Overflow, "Nesting is too deep"};
+            }
+
+            const auto children = tlv.Children();
+            std::size_t count = 0;
+            for (auto it = children.begin(); it != children.end(); ++it) {
+                ++count;
+            }
+            if (count == 0) {
+                return;
+            }
+
+            std::pmr::polymorphic_allocator<DecodedNode> allocator{resource_};
+            DecodedNode *nodes = allocator.allocate(count);
+            std::size_t i = 0;
+            for (auto &&child : children) {
+                Build(*new(nodes + i++) DecodedNode{}, child, depth + 1);
+            }
+
+            node.children = nodes;
+            node.children_count = count;
+        }
+
+    public:
+        /**
+         * @param view encoded TLV, trailing octets are ignored
+         * @param resource arena for the tree, e.g. DocumentArena::ThreadLocal().Resource()
+         * @param borrow_input if true, nodes refer to view, which shall outlive the document
+         */
+        explicit DecodedDocument(OctetView view, std::pmr::memory_resource *resource,
+                                 bool borrow_input = false) : resource_(resource) {
+            Instrumentation::Guard([&] {
+                const TlvView tlv{view};
+
+                if (borrow_input) {
+                    bytes_ = tlv.Bytes();
+                } else {
+                    auto *copy = static_cast<Octet *>(resource_->allocate(tlv.Bytes().size(), alignof(Octet)));
+                    std::copy(tlv.Bytes().begin(), tlv.Bytes().end(), copy);
+                    bytes_ = OctetView(copy, tlv.Bytes().size());
+                }
+
+                std::pmr::polymorphic_allocator<DecodedNode> allocator{resource_};
+                auto *root = new(allocator.allocate(1)) DecodedNode{};
+                Build(*root, TlvView{bytes_}, 0);
+                root_ = root;
+            });
+        }
+
+        [[nodiscard]] const DecodedNode &Root() const noexcept {
+            return *root_;
+        }
+
+        [[nodiscard]] OctetView Bytes() const noexcept {
+            return bytes_;
+        }
+
+        [[nodiscard]] std::pmr::memory_resource *Resource() const noexcept {
+            return resource_;
+        }
+    };
+}
+
+#endif //BER_DECODEDDOCUMENT_H
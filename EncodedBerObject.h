@@ -4,225 +4,468 @@
 #include "Octet.h"
 #include "OctetClasses.h"
 #include "Constants.h"
+#include "Instrumentation.h"
 
 #include <type_traits>
 #include <memory_resource>
 #include <cmath>
 #include <algorithm>
+#include <bit>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <stdexcept>
 
 namespace BER {
     using EncodedBerObject = std::pmr::vector<Octet>;
     using ContentsOctetList = std::pmr::vector<Octet>;
 
     namespace detail {
+        template<class OutputIt>
+        constexpr bool IsOctetOutputIterator = std::output_iterator<OutputIt, Octet>;
+
+        /**
+         * @return number of octets of the minimal two's complement representation of in
+         */
         template<class T>
-        ContentsOctetList IntegralContent(const T in) {
-            auto t = in;
+        constexpr std::size_t IntegralContentSize(const T in) noexcept {
+            using U = std::make_unsigned_t<T>;
+            if constexpr(std::is_signed_v<T>) {
+                const U magnitude = in < 0 ? static_cast<U>(~in) : static_cast<U>(in);
+                return std::bit_width(magnitude) / 8 + 1;
+            } else {
+                return std::bit_width(in) / 8 + 1;
+            }
+        }
 
-            ContentsOctetList content;
+        /**
+         * Write the lowest size octets of in's two's complement representation, most significant first.
+         * Octets beyond sizeof(T) are sign extension.
+         */
+        template<class T, class OutputIt>
+        constexpr OutputIt WriteIntegralContent(const T in, std::size_t size, OutputIt out) {
+            using U = std::make_unsigned_t<T>;
+            const auto u = static_cast<U>(in);
+
+            for (; size > sizeof(T); --size) {
+                *out++ = Octet(in < 0 ? 0xFF : 0);
+            }
+            while (size-- > 0) {
+                *out++ = Octet(static_cast<Octet::value_type>(u >> (8 * size)));
+            }
+            return out;
+        }
 
-            if constexpr(std::is_trivial_v<T>) {
-                content.reserve(sizeof(T));
+        constexpr std::size_t LengthSize(std::uintmax_t length) noexcept {
+            return length < 128 ? 1 : 1 + (std::bit_width(length) + 7) / 8;
+        }
+
+        template<class OutputIt>
+        constexpr OutputIt WriteLength(std::uintmax_t length, OutputIt out) {
+            if (!std::is_constant_evaluated()) {
+                Instrumentation::RecordEncodedLength(LengthSize(length));
+            }
+            if (length < 128) {
+                *out++ = LengthOctet(static_cast<Octet::value_type>(length));
+                return out;
             }
 
-            while (t != T{}) {
-                content.push_back(t & (pow_2<8, T> - 1)); // t % pow_2<8>
-                t /= pow_2<8, T>;
+            auto sub_cnt = LengthSize(length) - 1;
+            *out++ = LengthOctet(static_cast<Octet::value_type>(0x80 | sub_cnt));
+            while (sub_cnt-- > 0) {
+                *out++ = SubseqLengthOctet(static_cast<Octet::value_type>(length >> (8 * sub_cnt)));
             }
+            return out;
+        }
 
-            if (in == 0 || (in > 0 && (content.back().SubBits<7, 7>() == 1))) {
-                content.push_back(0);
+        constexpr std::size_t Base128Size(std::uintmax_t value) noexcept {
+            return value == 0 ? 1 : (std::bit_width(value) + 6) / 7;
+        }
+
+        /**
+         * Write value as base-128 digits, most significant first, bit 8 set on all but the last octet.
+         */
+        template<class OutputIt>
+        constexpr OutputIt WriteBase128(std::uintmax_t value, OutputIt out) {
+            for (auto i = Base128Size(value) - 1; i > 0; --i) {
+                *out++ = Octet(static_cast<Octet::value_type>(0x80 | ((value >> (7 * i)) & 0x7F)));
             }
+            *out++ = Octet(static_cast<Octet::value_type>(value & 0x7F));
+            return out;
+        }
 
-            return content;
+        constexpr std::size_t IdentifierSize(std::uintmax_t tag_number) noexcept {
+            return tag_number < 31 ? 1 : 1 + Base128Size(tag_number);
+        }
+
+        /**
+         * Write identifier octets, tag numbers from 31 on take the high-tag-number form.
+         */
+        template<class OutputIt>
+        constexpr OutputIt WriteIdentifier(IdentifierOctet::ClassTagType class_tag, bool constructed,
+                                 std::uintmax_t tag_number, OutputIt out) {
+            if (tag_number < 31) {
+                *out++ = IdentifierOctet{class_tag, IdentifierOctet::Constructed{constructed},
+                                         IdentifierOctet::TagNumberType{static_cast<int>(tag_number)}};
+                return out;
+            }
+            *out++ = IdentifierOctet{class_tag, IdentifierOctet::Constructed{constructed},
+                                     IdentifierOctet::TagNumberType{31}};
+            return WriteBase128(tag_number, out);
         }
 
         template<class T>
-        EncodedBerObject EncodeIntegral(const T in) {
+        constexpr std::size_t IntegralEncodedSize(const T in) noexcept {
+            const auto content_sz = IntegralContentSize(in);
+            return 1 + LengthSize(content_sz) + content_sz;
+        }
+
+        template<class T, class OutputIt>
+        OutputIt EncodeIntegral(const T in, OutputIt out) {
             static_assert(std::is_unsigned_v<T> ||
                           (T{} == ~T(-1)), "T shall be two's complement");
 
-            auto t = in;
-            EncodedBerObject result;
-            result.reserve(6);
-
-            IdentifierOctet id_octet{
+            const IdentifierOctet id_octet{
                     IdentifierOctet::ClassTagType{IdentifierOctet::Universal},
                     IdentifierOctet::Constructed{false},
                     IdentifierOctet::TagNumberType{UniversalTagList::INTEGER}
             };
 
-            result.push_back(id_octet);
+            const auto content_sz = IntegralContentSize(in);
+            *out++ = id_octet;
+            out = WriteLength(content_sz, out);
+            return WriteIntegralContent(in, content_sz, out);
+        }
 
-            ContentsOctetList content;
-            if constexpr(std::is_trivial_v<T>) {
-                content.reserve(sizeof(T));
-            }
+        /**
+         * REAL special values' contents octet, X.690 8.5.9
+         */
+        struct RealSpecial {
+            static constexpr Octet::value_type PlusInfinity = 0x40;
+            static constexpr Octet::value_type MinusInfinity = 0x41;
+            static constexpr Octet::value_type NotANumber = 0x42;
+            static constexpr Octet::value_type MinusZero = 0x43;
+        };
 
-            while (t != T{}) {
-                content.push_back(t & (pow_2<8, T> - 1)); // t % pow_2<8>
-                t >>= 8;
-                if constexpr(std::is_signed_v<T>) {
-                    if (t == T{-1}) {
-                        content.push_back(~0);
-                        break;
-                    }
+        /**
+         * Binary REAL decomposition: value = (negative ? -1 : 1) * mantissa * 2^exponent, mantissa is odd.
+         * special is non-zero for infinities, NaN and -0.
+         */
+        struct RealParts {
+            bool zero;
+            Octet::value_type special;
+            bool negative;
+            int exponent;
+            std::uintmax_t mantissa;
+            std::size_t exp_size;
+            std::size_t mant_size;
+
+            [[nodiscard]] constexpr std::size_t ContentSize() const noexcept {
+                if (zero) {
+                    return 0;
                 }
+                return special != 0 ? 1 : 1 /*info_octet*/ + exp_size + mant_size;
             }
+        };
 
-            if (in > 0 && (content.back().SubBits<7, 7>() == 1)) {
-                content.push_back(0);
-            }
+        template<class T>
+        using IeeeBitsType = std::conditional_t<sizeof(T) == sizeof(std::uint32_t), std::uint32_t, std::uint64_t>;
+
+        template<class T>
+        constexpr bool IsIeeeBinary = std::numeric_limits<T>::is_iec559 &&
+                                      (sizeof(T) == sizeof(std::uint32_t) || sizeof(T) == sizeof(std::uint64_t));
+
+        /**
+         * Take sign, exponent and mantissa straight from the IEEE-754 bit pattern,
+         * trailing zeros of the mantissa are stripped with one count-trailing-zeros.
+         * Other floating point formats go through frexp/ldexp, which are exact.
+         */
+        template<class T>
+        constexpr RealParts DecomposeReal(const T in) noexcept {
+            static_assert(std::numeric_limits<T>::radix == 2 &&
+                          std::numeric_limits<T>::digits <= std::numeric_limits<std::uintmax_t>::digits);
 
-            if ((std::is_trivial_v<T> && sizeof(T) < pow_2<8>) || content.size() < pow_2<8>) {
-                result.reserve(1 + content.size());
-                result.push_back(content.size());
+            RealParts parts{};
+            int exp;
+            std::uintmax_t mantissa;
+
+            if constexpr(IsIeeeBinary<T>) {
+                using Bits = IeeeBitsType<T>;
+                constexpr int frac_bits = std::numeric_limits<T>::digits - 1;
+                constexpr int exp_bits = sizeof(Bits) * CHAR_BIT - 1 - frac_bits;
+                constexpr Bits frac_mask = (Bits{1} << frac_bits) - 1;
+                constexpr Bits exp_mask = (Bits{1} << exp_bits) - 1;
+                constexpr int bias = std::numeric_limits<T>::max_exponent - 1;
+
+                const auto bits = std::bit_cast<Bits>(in);
+                const bool negative = (bits >> (sizeof(Bits) * CHAR_BIT - 1)) != 0;
+                const auto biased_exp = static_cast<int>((bits >> frac_bits) & exp_mask);
+                const Bits frac = bits & frac_mask;
+
+                if (biased_exp == exp_mask) {
+                    parts.special = frac != 0 ? RealSpecial::NotANumber
+                                              : negative ? RealSpecial::MinusInfinity : RealSpecial::PlusInfinity;
+                    return parts;
+                }
+                if (biased_exp == 0) {
+                    if (frac == 0) {
+                        parts.zero = !negative;
+                        parts.special = negative ? RealSpecial::MinusZero : 0;
+                        return parts;
+                    }
+                    mantissa = frac;
+                    exp = 1 - bias - frac_bits;
+                } else {
+                    mantissa = frac | (Bits{1} << frac_bits);
+                    exp = biased_exp - bias - frac_bits;
+                }
+                parts.negative = negative;
             } else {
-                double sublength_oct_cnt = std::log(content.size()) / std::log(pow_2<9>) + 1;
-                if (sublength_oct_cnt >= pow_2<8> - 1) {
-                    throw std::logic_error{"Integer overflow"};
+                if (in != in) {
+                    parts.special = RealSpecial::NotANumber;
+                    return parts;
                 }
-                result.reserve(sublength_oct_cnt + 1 + content.size());
-
-                result.push_back(PackOctet(OctetBits<1>{1}, OctetBits<7>{static_cast<int>(sublength_oct_cnt)}));
-                for (int i = sublength_oct_cnt - 1; i >= 0; --i) {
-                    result.push_back((content.size() >> (i * 8)) & 0xFF);
+                if (in == std::numeric_limits<T>::infinity() || in == -std::numeric_limits<T>::infinity()) {
+                    parts.special = in < 0 ? RealSpecial::MinusInfinity : RealSpecial::PlusInfinity;
+                    return parts;
                 }
+                if (in == 0) {
+                    parts.zero = !std::signbit(in);
+                    parts.special = std::signbit(in) ? RealSpecial::MinusZero : 0;
+                    return parts;
+                }
+                const auto norm_mant = std::frexp(in, &exp);
+                exp -= std::numeric_limits<T>::digits;
+                mantissa = static_cast<std::uintmax_t>(std::ldexp(std::abs(norm_mant), std::numeric_limits<T>::digits));
+                parts.negative = in < 0;
             }
 
-            std::for_each(std::rbegin(content), std::rend(content), [&](auto &&el) {
-                result.push_back(el);
-            });
-
-            return result;
+            const auto tz = std::countr_zero(mantissa);
+            parts.mantissa = mantissa >> tz;
+            parts.exponent = exp + tz;
+            parts.exp_size = IntegralContentSize(parts.exponent);
+            parts.mant_size = (std::bit_width(parts.mantissa) + 7) / 8;
+            return parts;
         }
 
         template<class T>
-        EncodedBerObject EncodeReal(const T in) {
-            EncodedBerObject result;
-            result.reserve(5);
-
-            const IdentifierOctet id_octet{
-                    IdentifierOctet::ClassTagType{IdentifierOctet::Universal},
-                    IdentifierOctet::Constructed{false},
-                    IdentifierOctet::TagNumberType{UniversalTagList::REAL}
-            };
-
-            result.push_back(id_octet);
+        constexpr std::size_t RealEncodedSize(const T in) noexcept {
+            const auto content_sz = DecomposeReal(in).ContentSize();
+            return 1 + LengthSize(content_sz) + content_sz;
+        }
 
-            if (in == 0) {
-                result.push_back(0);
-                return result;
+        template<class OutputIt>
+        OutputIt WriteRealContent(const RealParts &parts, OutputIt out) {
+            if (parts.zero) {
+                return out;
             }
-
-            int exp;
-            const auto norm_mant = std::frexp(in, &exp);
-            exp -= std::numeric_limits<T>::digits;
-
-            auto choose_exp_sz = [](auto sz) {
-                if (sz == 1) {
-                    return 0b00;
-                } else if (sz == 2) {
-                    return 0b01;
-                } else if (sz == 3) {
-                    return 0b10;
-                } else {
-                    return 0b11;
-                }
-            };
-
-            std::uintmax_t mantissa =
-                    std::abs(norm_mant) * std::pow(std::numeric_limits<T>::radix, std::numeric_limits<T>::digits);
-
-            while ((mantissa & 1) == 0) {
-                mantissa >>= 1;
-                ++exp;
+            if (parts.special != 0) {
+                *out++ = Octet(parts.special);
+                return out;
             }
 
-            const auto mant_content = IntegralContent(mantissa);
-
-            const auto exp_content = IntegralContent(exp);
-
+            // exponent of a binary-radix T always fits into 3 octets
             const Octet info_octet = PackOctet(
                     OctetBits<1>{1}, // binary encoding
-                    OctetBits<1>{in < 0}, // mantissa's sign
+                    OctetBits<1>{parts.negative}, // mantissa's sign
                     OctetBits<2>{0}, // base 2
                     OctetBits<2>{0}, // F
-                    OctetBits<2>{
-                            choose_exp_sz(exp_content.size())
-                    }
+                    OctetBits<2>{static_cast<int>(parts.exp_size - 1)}
             );
 
-            ContentsOctetList dop_content;
+            *out++ = info_octet;
+            out = WriteIntegralContent(parts.exponent, parts.exp_size, out);
+            return WriteIntegralContent(parts.mantissa, parts.mant_size, out);
+        }
+
+        template<class T, class OutputIt>
+        OutputIt EncodeReal(const T in, OutputIt out) {
+            const IdentifierOctet id_octet{
+                    IdentifierOctet::ClassTagType{IdentifierOctet::Universal},
+                    IdentifierOctet::Constructed{false},
+                    IdentifierOctet::TagNumberType{UniversalTagList::REAL}
+            };
 
-            if (choose_exp_sz(exp_content.size()) == 0b11) {
-                dop_content = EncodeIntegral(exp_content.size());
-            }
+            const auto parts = DecomposeReal(in);
 
-            result.push_back(
-                    LengthOctet(1 /*info_octet*/ + mant_content.size() + exp_content.size() + dop_content.size())
-            );
+            *out++ = id_octet;
+            out = WriteLength(parts.ContentSize(), out);
+            return WriteRealContent(parts, out);
+        }
 
-            result.push_back(info_octet);
-            for (auto &&el : exp_content) {
-                result.push_back(el);
-            }
+        template<class Value>
+        std::size_t EncodeToSpan(const Value &value, std::size_t size, std::span<Octet> out);
+    }
 
-            for (auto &&el : mant_content) {
-                result.push_back(el);
-            }
+    constexpr std::size_t EncodedSize(bool) noexcept {
+        return 3;
+    }
 
-            return result;
+    template<class T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    std::size_t EncodedSize(T t) {
+        if constexpr(std::is_integral_v<T>) {
+            return detail::IntegralEncodedSize(t);
+        } else if constexpr(std::is_floating_point_v<T>) {
+            return detail::RealEncodedSize(t);
         }
     }
 
-    EncodedBerObject Encode(bool b) {
+    constexpr std::size_t EncodedSize(OctetView str) noexcept {
+        return 1 + detail::LengthSize(str.size()) + str.size();
+    }
+
+    /**
+     * Encode straight into an output iterator, exactly EncodedSize() octets are written.
+     * @return iterator past the last written octet
+     */
+    template<class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(bool b, OutputIt out) {
         IdentifierOctet id_octet{
                 IdentifierOctet::ClassTagType{IdentifierOctet::Universal},
                 IdentifierOctet::Constructed{false},
                 IdentifierOctet::TagNumberType{UniversalTagList::BOOLEAN}
         };
 
-        LengthOctet length_octet{1};
-        ContentOctet content{b};
-        return {id_octet, length_octet, content};
+        Instrumentation::RecordEncoded(UniversalTagList::BOOLEAN, EncodedSize(b));
+        Instrumentation::RecordEncodedLength(1);
+        *out++ = id_octet;
+        *out++ = LengthOctet{1};
+        *out++ = ContentOctet{b};
+        return out;
     }
 
-    template<class T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
-    EncodedBerObject Encode(T t) {
+    template<class T, class OutputIt,
+            typename = std::enable_if_t<std::is_arithmetic_v<T> && detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(T t, OutputIt out) {
+        if constexpr(Instrumentation::enabled) {
+            Instrumentation::RecordEncoded(std::is_integral_v<T> ? UniversalTagList::INTEGER : UniversalTagList::REAL,
+                                           EncodedSize(t));
+        }
         if constexpr(std::is_integral_v<T>) {
-            return detail::EncodeIntegral(t);
+            return detail::EncodeIntegral(t, out);
         } else if constexpr(std::is_floating_point_v<T>) {
-            return detail::EncodeReal(t);
+            return detail::EncodeReal(t, out);
         }
     }
 
-    EncodedBerObject Encode(OctetView str) {
-        EncodedBerObject result;
-
-        IdentifierOctet identifierOctet {
-            IdentifierOctet::Universal,
-            IdentifierOctet::Constructed{false},
-            IdentifierOctet::TagNumberType{UniversalTagList::OCTET_STRING}
+    template<class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(OctetView str, OutputIt out) {
+        IdentifierOctet identifierOctet{
+                IdentifierOctet::Universal,
+                IdentifierOctet::Constructed{false},
+                IdentifierOctet::TagNumberType{UniversalTagList::OCTET_STRING}
         };
 
-        const LengthOctets length = LengthOctets::Encode(str.size());
+        Instrumentation::RecordEncoded(UniversalTagList::OCTET_STRING, EncodedSize(str));
+        *out++ = identifierOctet;
+        out = detail::WriteLength(str.size(), out);
+        return std::copy(str.begin(), str.end(), out);
+    }
 
-        result.reserve(sizeof(IdentifierOctet) + sizeof(LengthOctet) + length.sub_octets.size() + str.size());
+    /**
+     * Encode into caller-supplied storage.
+     * @return number of written octets
+     * @throws std::length_error if out is shorter than EncodedSize()
+     */
+    inline std::size_t EncodeTo(bool b, std::span<Octet> out) {
+        return detail::EncodeToSpan(b, EncodedSize(b), out);
+    }
 
-        result.push_back(identifierOctet);
-        result.push_back(length.main_octet);
+    template<class T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    std::size_t EncodeTo(T t, std::span<Octet> out) {
+        return detail::EncodeToSpan(t, EncodedSize(t), out);
+    }
 
-        for (auto &&el : length.sub_octets) {
-            result.push_back(el);
-        }
+    inline std::size_t EncodeTo(OctetView str, std::span<Octet> out) {
+        return detail::EncodeToSpan(str, EncodedSize(str), out);
+    }
 
-        for (auto &&el : str) {
-            result.push_back(el);
+    template<class Value>
+    std::size_t detail::EncodeToSpan(const Value &value, std::size_t size, std::span<Octet> out) {
+        if (out.size() < size) {
+            throw std::length_error{"Buffer is too small"};
         }
+        EncodeTo(value, out.data());
+        return size;
+    }
+
+    inline EncodedBerObject Encode(bool b) {
+        EncodedBerObject result(EncodedSize(b));
+        EncodeTo(b, result.data());
+        return result;
+    }
 
+    template<class T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    EncodedBerObject Encode(T t) {
+        EncodedBerObject result(EncodedSize(t));
+        EncodeTo(t, result.data());
         return result;
     }
+
+    inline EncodedBerObject Encode(OctetView str) {
+        EncodedBerObject result(EncodedSize(str));
+        EncodeTo(str, result.data());
+        return result;
+    }
+
+    /**
+     * OCTET STRING from a char or byte buffer, the buffer is read in place.
+     */
+    inline std::size_t EncodedSize(std::string_view str) noexcept {
+        return EncodedSize(AsOctetView(str));
+    }
+
+    inline std::size_t EncodedSize(std::span<const std::byte> bytes) noexcept {
+        return EncodedSize(AsOctetView(bytes));
+    }
+
+    template<class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(std::string_view str, OutputIt out) {
+        return EncodeTo(AsOctetView(str), out);
+    }
+
+    template<class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(std::span<const std::byte> bytes, OutputIt out) {
+        return EncodeTo(AsOctetView(bytes), out);
+    }
+
+    inline EncodedBerObject Encode(std::string_view str) {
+        return Encode(AsOctetView(str));
+    }
+
+    inline EncodedBerObject Encode(std::span<const std::byte> bytes) {
+        return Encode(AsOctetView(bytes));
+    }
+
+    namespace detail {
+        template<class Container>
+        constexpr bool IsByteContainer = std::is_same_v<typename Container::value_type, char> ||
+                                         std::is_same_v<typename Container::value_type, unsigned char> ||
+                                         std::is_same_v<typename Container::value_type, std::byte>;
+    }
+
+    /**
+     * Encode straight into a byte container, e.g. std::string or std::vector<std::byte>.
+     */
+    template<class Container, class T, typename = std::enable_if_t<detail::IsByteContainer<Container>>>
+    Container EncodeAs(const T &value) {
+        Container result(EncodedSize(value), typename Container::value_type{});
+        EncodeTo(value, reinterpret_cast<Octet *>(result.data()));
+        return result;
+    }
+
+    /**
+     * Append the encoding to a byte container.
+     * @return number of appended octets
+     */
+    template<class T, class Container, typename = std::enable_if_t<detail::IsByteContainer<Container>>>
+    std::size_t EncodeAppend(const T &value, Container &out) {
+        const auto pos = out.size();
+        const auto size = EncodedSize(value);
+        out.resize(pos + size);
+        EncodeTo(value, reinterpret_cast<Octet *>(out.data() + pos));
+        return size;
+    }
 }
 
 
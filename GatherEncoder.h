@@ -0,0 +1,294 @@
+#ifndef BER_GATHERENCODER_H
+#define BER_GATHERENCODER_H
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <sys/uio.h>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "EncodedBerObject.h"
+
+namespace BER {
+    /**
+     * Encoding split into iovecs: identifier and length octets and small values live in an owned buffer,
+     * large payloads are referenced where the caller keeps them and shall outlive this object.
+     */
+    class GatheredBerObject {
+        EncodedBerObject owned_;
+        std::pmr::vector<iovec> iov_;
+        std::size_t size_{};
+
+    public:
+        GatheredBerObject(EncodedBerObject owned, std::pmr::vector<iovec> iov, std::size_t size) :
+                owned_(std::move(owned)), iov_(std::move(iov)), size_(size) {}
+
+        // the iovecs point into owned_, so only a move construction, which keeps its storage, is safe
+        GatheredBerObject(const GatheredBerObject &) = delete;
+
+        GatheredBerObject(GatheredBerObject &&) noexcept = default;
+
+        GatheredBerObject &operator=(const GatheredBerObject &) = delete;
+
+        GatheredBerObject &operator=(GatheredBerObject &&) = delete;
+
+        /**
+         * Segments in wire order, ready for writev()/sendmsg().
+         */
+        [[nodiscard]] std::span<const iovec> Iovecs() const noexcept {
+            return iov_;
+        }
+
+        /**
+         * Total size of the encoding.
+         */
+        [[nodiscard]] std::size_t Size() const noexcept {
+            return size_;
+        }
+
+        /**
+         * Octets held by this object itself, the rest is referenced.
+         */
+        [[nodiscard]] std::size_t OwnedSize() const noexcept {
+            return owned_.size();
+        }
+
+        /**
+         * Contiguous copy of the encoding.
+         */
+        [[nodiscard]] EncodedBerObject Flatten() const {
+            EncodedBerObject result(size_, owned_.get_allocator());
+            auto *out = result.data();
+            for (auto &&segment : iov_) {
+                out = std::copy_n(static_cast<const Octet *>(segment.iov_base), segment.iov_len, out);
+            }
+            return result;
+        }
+
+        /**
+         * Write the whole encoding to fd with writev(), retrying short writes.
+         * @throws std::system_error if writev() fails
+         */
+        void WriteTo(int fd) const {
+            constexpr std::size_t batch_size = 64; // well below IOV_MAX
+            std::array<iovec, batch_size> batch;
+            std::size_t i = 0;
+            std::size_t skip = 0; // octets of iov_[i] already written
+
+            while (i < iov_.size()) {
+                const auto count = std::min(batch_size, iov_.size() - i);
+                std::copy_n(iov_.begin() + i, count, batch.begin());
+                batch[0].iov_base = static_cast<char *>(batch[0].iov_base) + skip;
+                batch[0].iov_len -= skip;
+
+                auto written = ::writev(fd, batch.data(), static_cast<int>(count));
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error{errno, std::generic_category(), "writev"};
+                }
+                // zero-length segments are stepped over even if nothing was written
+                for (auto left = static_cast<std::size_t>(written); i < iov_.size();) {
+                    const auto rest = iov_[i].iov_len - skip;
+                    if (left < rest) {
+                        skip += left;
+                        break;
+                    }
+                    left -= rest;
+                    skip = 0;
+                    ++i;
+                }
+            }
+        }
+    };
+
+    /**
+     * Definite-length encoder which references large payloads instead of copying them.
+     * Headers, constructed ones included, are written into one small buffer; a constructed header
+     * is appended when its level is closed and takes its place in the segment list through a slot
+     * reserved in Begin(), so nothing is shifted or copied twice.
+     */
+    class GatherEncoder {
+        static constexpr std::size_t pending = std::numeric_limits<std::size_t>::max();
+
+        struct Segment {
+            const Octet *external; // nullptr for octets of owned_
+            std::size_t offset;    // into owned_, pending for an open level's header
+            std::size_t size;
+        };
+
+        struct Level {
+            std::size_t segment;
+            std::size_t content_pos;
+            IdentifierOctet::ClassTagType class_tag;
+            std::uintmax_t tag_number;
+        };
+
+        EncodedBerObject owned_;
+        std::pmr::vector<Segment> segments_;
+        std::pmr::vector<Level> levels_;
+        std::size_t size_{};
+        std::size_t copy_threshold_;
+
+        /**
+         * Append n octets to the owned buffer, merging them into the last segment if it ends there.
+         */
+        Octet *Grow(std::size_t n) {
+            const auto pos = owned_.size();
+            owned_.resize(pos + n);
+            size_ += n;
+            if (!segments_.empty()) {
+                auto &last = segments_.back();
+                if (last.external == nullptr && last.offset != pending && last.offset + last.size == pos) {
+                    last.size += n;
+                    return owned_.data() + pos;
+                }
+            }
+            segments_.push_back({nullptr, pos, n});
+            return owned_.data() + pos;
+        }
+
+        void Reference(OctetView payload) {
+            if (payload.empty()) {
+                return;
+            }
+            if (payload.size() < copy_threshold_) {
+                std::copy(payload.begin(), payload.end(), Grow(payload.size()));
+                return;
+            }
+            segments_.push_back({payload.data(), 0, payload.size()});
+            size_ += payload.size();
+        }
+
+    public:
+        /**
+         * @param copy_threshold payloads shorter than this are copied, a segment of their own costs more
+         */
+        explicit GatherEncoder(std::size_t copy_threshold = 256,
+                               std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+                owned_(resource), segments_(resource), levels_(resource), copy_threshold_(copy_threshold) {}
+
+        /**
+         * Open a constructed TLV, tag numbers from 31 on take the high-tag-number form.
+         */
+        GatherEncoder &Begin(IdentifierOctet::ClassTagType class_tag, std::uintmax_t tag_number) {
+            levels_.push_back({segments_.size(), size_, class_tag, tag_number});
+            segments_.push_back({nullptr, pending, 0});
+            return *this;
+        }
+
+        GatherEncoder &Begin(UniversalTagList::Type tag = UniversalTagList::SEQUENCE) {
+            return Begin(IdentifierOctet::Universal, static_cast<std::uintmax_t>(tag));
+        }
+
+        /**
+         * Close the innermost open TLV.
+         */
+        GatherEncoder &End() {
+            if (levels_.empty()) {
+                throw std::logic_error{"No open constructed encoding"};
+            }
+
+            const auto level = levels_.back();
+            levels_.pop_back();
+
+            const auto content_sz = size_ - level.content_pos;
+            const auto header_sz = detail::IdentifierSize(level.tag_number) + detail::LengthSize(content_sz);
+            const auto pos = owned_.size();
+            owned_.resize(pos + header_sz);
+            detail::WriteLength(content_sz, detail::WriteIdentifier(level.class_tag, true, level.tag_number,
+                                                                    owned_.data() + pos));
+            segments_[level.segment] = {nullptr, pos, header_sz};
+            size_ += header_sz;
+
+            Instrumentation::RecordEncoded(level.class_tag.value == IdentifierOctet::Universal.value
+                                           ? level.tag_number : std::numeric_limits<std::uintmax_t>::max(),
+                                           header_sz + content_sz);
+            return *this;
+        }
+
+        /**
+         * Append a primitive OCTET STRING, contents of at least copy_threshold octets are referenced.
+         */
+        GatherEncoder &Add(OctetView str) {
+            const auto header_sz = 1 + detail::LengthSize(str.size());
+            auto *out = Grow(header_sz);
+            *out++ = IdentifierOctet{
+                    IdentifierOctet::Universal,
+                    IdentifierOctet::Constructed{false},
+                    IdentifierOctet::TagNumberType{UniversalTagList::OCTET_STRING}
+            };
+            detail::WriteLength(str.size(), out);
+            Instrumentation::RecordEncoded(UniversalTagList::OCTET_STRING, header_sz + str.size());
+            Reference(str);
+            return *this;
+        }
+
+        /**
+         * Append an encoded value into the owned buffer, see EncodeTo().
+         */
+        template<class T>
+        GatherEncoder &Add(const T &value) {
+            EncodeTo(value, Grow(EncodedSize(value)));
+            return *this;
+        }
+
+        /**
+         * Append an already encoded TLV, referenced like OCTET STRING contents.
+         */
+        GatherEncoder &AddEncoded(OctetView tlv) {
+            Reference(tlv);
+            return *this;
+        }
+
+        [[nodiscard]] std::size_t Depth() const noexcept {
+            return levels_.size();
+        }
+
+        [[nodiscard]] std::size_t Size() const noexcept {
+            return size_;
+        }
+
+        /**
+         * Take the result, all levels shall be closed. The encoder is left empty.
+         */
+        GatheredBerObject Release() {
+            if (!levels_.empty()) {
+                throw std::logic_error{"Constructed encoding is not closed"};
+            }
+
+            std::pmr::vector<iovec> iov(segments_.size(), segments_.get_allocator());
+            for (std::size_t i = 0; i < segments_.size(); ++i) {
+                const auto &segment = segments_[i];
+                const Octet *base = segment.external != nullptr ? segment.external : owned_.data() + segment.offset;
+                iov[i] = {const_cast<Octet *>(base), segment.size};
+            }
+
+            // moving keeps owned_'s storage, so the iovecs stay valid
+            GatheredBerObject result{std::move(owned_), std::move(iov), size_};
+            Clear();
+            return result;
+        }
+
+        void Clear() noexcept {
+            owned_.clear();
+            segments_.clear();
+            levels_.clear();
+            size_ = 0;
+        }
+    };
+}
+
+#endif //BER_GATHERENCODER_H
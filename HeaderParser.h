@@ -0,0 +1,190 @@
+#ifndef BER_HEADERPARSER_H
+#define BER_HEADERPARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Instrumentation.h"
+
+namespace BER {
+    enum class HeaderError : std::uint8_t {
+        None,
+        Empty,
+        TruncatedIdentifier,
+        TagOverflow,
+        TruncatedLength,
+        LengthOverflow,
+        ReservedLength
+    };
+
+    namespace detail {
+        /**
+         * High tag numbers and long or indefinite lengths.
+         */
+        constexpr HeaderError ParseHeaderSlow(OctetView view, TlvHeader &header) noexcept {
+            if (view.empty()) {
+                return HeaderError::Empty;
+            }
+
+            header = TlvHeader{};
+            header.identifier = IdentifierOctet{view[0]};
+            header.tag_number = view[0] & 0x1F;
+            std::size_t pos = 1;
+
+            if (header.tag_number == 0x1F) {
+                header.tag_number = 0;
+                for (;;) {
+                    if (pos == view.size()) {
+                        return HeaderError::TruncatedIdentifier;
+                    }
+                    if (header.tag_number > (std::numeric_limits<std::uintmax_t>::max() >> 7)) {
+                        return HeaderError::TagOverflow;
+                    }
+                    const Octet octet = view[pos++];
+                    header.tag_number = (header.tag_number << 7) | (octet & 0x7F);
+                    if ((octet & 0x80) == 0) {
+                        break;
+                    }
+                }
+            }
+            header.identifier_size = static_cast<std::uint8_t>(pos);
+
+            if (pos == view.size()) {
+                return HeaderError::TruncatedLength;
+            }
+            const Octet first = view[pos++];
+            if (first < 0x80) {
+                header.length = first;
+            } else if (first == 0x80) {
+                header.indefinite = true;
+            } else if (first == 0xFF) {
+                return HeaderError::ReservedLength;
+            } else {
+                const std::size_t count = first & 0x7F;
+                if (count > sizeof(std::uintmax_t)) {
+                    return HeaderError::LengthOverflow;
+                }
+                if (view.size() - pos < count) {
+                    return HeaderError::TruncatedLength;
+                }
+                if (sizeof(std::uintmax_t) == sizeof(std::uint64_t) && !std::is_constant_evaluated() &&
+                    view.size() - pos >= sizeof(std::uint64_t)) {
+                    header.length = LoadBigEndian64(view.data() + pos) >> (64 - 8 * count);
+                } else {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        header.length = (header.length << 8) | view[pos + i];
+                    }
+                }
+                pos += count;
+            }
+
+            header.header_size = pos;
+            return HeaderError::None;
+        }
+    }
+
+    /**
+     * Parse identifier and length octets at the beginning of view. Contents are not looked at,
+     * so the length is not checked against the view either.
+     * A one-octet identifier followed by a short-form length, nearly every TLV, takes a single branch.
+     */
+    constexpr HeaderError TryParseHeader(OctetView view, TlvHeader &header) noexcept {
+        if (view.size() >= 2) {
+            const Octet id = view[0];
+            const Octet length = view[1];
+            if ((id & 0x1F) != 0x1F && length < 0x80) {
+                header = TlvHeader{IdentifierOctet{id}, static_cast<std::uintmax_t>(id & 0x1F), length, 2, false, 1};
+                return HeaderError::None;
+            }
+        }
+        return detail::ParseHeaderSlow(view, header);
+    }
+
+    constexpr const char *HeaderErrorMessage(HeaderError error) noexcept {
+        switch (error) {
+            case HeaderError::None:
+                return "Valid";
+            case HeaderError::Empty:
+                return "Empty octet stream";
+            case HeaderError::TruncatedIdentifier:
+                return "Truncated identifier";
+            case HeaderError::TagOverflow:
+            case HeaderError::LengthOverflow:
+                return "Integer overflow";
+            case HeaderError::TruncatedLength:
+                return "Truncated length";
+            case HeaderError::ReservedLength:
+                return "Reserved length octet";
+        }
+        return "Unknown error";
+    }
+
+    constexpr ErrorKind HeaderErrorKind(HeaderError error) noexcept {
+        switch (error) {
+            case HeaderError::Empty:
+            case HeaderError::TruncatedIdentifier:
+            case HeaderError::TruncatedLength:
+                return ErrorKind::Truncated;
+            case HeaderError::TagOverflow:
+            case HeaderError::LengthOverflow:
+                return ErrorKind::Overflow;
+            default:
+                return ErrorKind::Malformed;
+        }
+    }
+
+    /**
+     * Parse identifier and length octets, see TryParseHeader().
+     * @throws DecodeError on malformed or truncated octets
+     */
+    inline TlvHeader ParseHeader(OctetView view) {
+        TlvHeader header;
+        const auto error = TryParseHeader(view, header);
+        if (error != HeaderError::None) {
+            throw DecodeError{HeaderErrorKind(error), HeaderErrorMessage(error)};
+        }
+        return header;
+    }
+
+    namespace detail {
+        /**
+         * Count a decoded TLV of encoded_size octets by tag and length form. Called once per TLV
+         * by the decoding entry points, not by ParseHeader(), which the decoders repeat.
+         */
+        inline void RecordDecodedTlv([[maybe_unused]] const TlvHeader &header,
+                                     [[maybe_unused]] std::size_t encoded_size) noexcept {
+            if constexpr(Instrumentation::enabled) {
+                const bool universal = header.identifier.ClassTag().value == IdentifierOctet::Universal.value;
+                Instrumentation::RecordDecoded(universal ? header.tag_number : std::numeric_limits<std::uintmax_t>::max(),
+                                               encoded_size);
+                Instrumentation::RecordDecodedLength(header.header_size - header.identifier_size, header.indefinite);
+            }
+        }
+    }
+
+    namespace detail {
+        /**
+         * Contents of a primitive TLV which shall span the whole view.
+         */
+        inline OctetView PrimitiveContent(OctetView encoded) {
+            const auto header = ParseHeader(encoded);
+            if (header.identifier.IsConstructed()) {
+                throw std::logic_error{"Constructed encoding is not allowed"};
+            }
+            if (header.indefinite) {
+                throw std::logic_error{"Indefinite length for primitive encoding"};
+            }
+            if (header.length != encoded.size() - header.header_size) {
+                throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+            }
+            return encoded.substr(header.header_size);
+        }
+    }
+}
+
+#endif //BER_HEADERPARSER_H
@@ -0,0 +1,293 @@
+#ifndef BER_INSTRUMENTATION_H
+#define BER_INSTRUMENTATION_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory_resource>
+#include <stdexcept>
+#include <utility>
+
+#include "Constants.h"
+
+#ifndef BER_INSTRUMENTATION
+#define BER_INSTRUMENTATION 0
+#endif
+
+/**
+ * Hot-path counters, compiled in with -DBER_INSTRUMENTATION=1 (CMake option BER_INSTRUMENTATION).
+ * Otherwise every hook is an empty inline function and the library behaves exactly as without it.
+ */
+namespace BER::Instrumentation {
+    inline constexpr bool enabled = BER_INSTRUMENTATION != 0;
+
+    /**
+     * Per-tag counters are indexed by the universal tag number, tag_buckets - 1 collects
+     * all other tags (high tag numbers and non-universal classes).
+     */
+    inline constexpr std::size_t tag_buckets = 32;
+
+    enum class ErrorKind {
+        Truncated,      // input ends inside a TLV
+        SizeMismatch,   // length octets disagree with the available or expected contents
+        Overflow,       // tag number, length, value or nesting depth does not fit
+        Unsupported,    // valid encoding the decoder does not handle
+        Malformed,      // any other rejected input
+        Count
+    };
+}
+
+namespace BER {
+    using ErrorKind = Instrumentation::ErrorKind;
+
+    /**
+     * Rejected input whose kind is known at the throw site. It is still a std::logic_error,
+     * other logic errors count as ErrorKind::Malformed.
+     */
+    class DecodeError : public std::logic_error {
+        ErrorKind kind_;
+
+    public:
+        DecodeError(ErrorKind kind, const char *what) : std::logic_error(what), kind_(kind) {}
+
+        [[nodiscard]] ErrorKind Kind() const noexcept {
+            return kind_;
+        }
+    };
+}
+
+namespace BER::Instrumentation {
+    struct LengthForms {
+        std::uint64_t short_form{};
+        std::uint64_t long_form{};
+        std::uint64_t indefinite{};
+    };
+
+    struct ResourceStats {
+        const void *resource{};
+        std::uint64_t allocations{};
+        std::uint64_t deallocations{};
+        std::uint64_t bytes_allocated{};
+        std::uint64_t bytes_in_use{};
+        std::uint64_t peak_bytes_in_use{};
+    };
+
+    struct Snapshot {
+        std::array<std::uint64_t, tag_buckets> encoded_bytes{};
+        std::array<std::uint64_t, tag_buckets> decoded_bytes{};
+        LengthForms encoded_lengths;
+        LengthForms decoded_lengths;
+        std::array<std::uint64_t, static_cast<std::size_t>(ErrorKind::Count)> errors{};
+        ResourceStats default_resource; // allocations from the default memory resource
+    };
+
+    /**
+     * Memory resource counting allocations passed on to the upstream resource.
+     */
+    class CountingResource : public std::pmr::memory_resource {
+        std::pmr::memory_resource *upstream_;
+        std::atomic<std::uint64_t> allocations_{};
+        std::atomic<std::uint64_t> deallocations_{};
+        std::atomic<std::uint64_t> bytes_allocated_{};
+        std::atomic<std::uint64_t> bytes_in_use_{};
+        std::atomic<std::uint64_t> peak_bytes_in_use_{};
+
+        void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+            void *p = upstream_->allocate(bytes, alignment);
+            allocations_.fetch_add(1, std::memory_order_relaxed);
+            bytes_allocated_.fetch_add(bytes, std::memory_order_relaxed);
+            const auto in_use = bytes_in_use_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            auto peak = peak_bytes_in_use_.load(std::memory_order_relaxed);
+            while (in_use > peak && !peak_bytes_in_use_.compare_exchange_weak(peak, in_use,
+                                                                              std::memory_order_relaxed)) {
+            }
+            return p;
+        }
+
+        void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+            upstream_->deallocate(p, bytes, alignment);
+            deallocations_.fetch_add(1, std::memory_order_relaxed);
+            bytes_in_use_.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+            return this == &other;
+        }
+
+    public:
+        explicit CountingResource(std::pmr::memory_resource *upstream = std::pmr::get_default_resource()) :
+                upstream_(upstream) {}
+
+        [[nodiscard]] std::pmr::memory_resource *Upstream() const noexcept {
+            return upstream_;
+        }
+
+        [[nodiscard]] ResourceStats Stats() const noexcept {
+            return {
+                    upstream_,
+                    allocations_.load(std::memory_order_relaxed),
+                    deallocations_.load(std::memory_order_relaxed),
+                    bytes_allocated_.load(std::memory_order_relaxed),
+                    bytes_in_use_.load(std::memory_order_relaxed),
+                    peak_bytes_in_use_.load(std::memory_order_relaxed)
+            };
+        }
+    };
+
+    namespace detail {
+        struct Counters {
+            std::array<std::atomic<std::uint64_t>, tag_buckets> encoded_bytes{};
+            std::array<std::atomic<std::uint64_t>, tag_buckets> decoded_bytes{};
+            std::array<std::atomic<std::uint64_t>, 3> encoded_lengths{};
+            std::array<std::atomic<std::uint64_t>, 3> decoded_lengths{};
+            std::array<std::atomic<std::uint64_t>, static_cast<std::size_t>(ErrorKind::Count)> errors{};
+        };
+
+        inline Counters counters;
+
+        /**
+         * Counting wrapper of the default resource, installed as the default resource in its place.
+         * Never destroyed since containers may outlive any static destructor.
+         */
+        inline CountingResource &CountingDefault() {
+            static auto *resource = [] {
+                auto *counting = new CountingResource{std::pmr::get_default_resource()};
+                std::pmr::set_default_resource(counting);
+                return counting;
+            }();
+            return *resource;
+        }
+
+        /**
+         * Allocations are counted without handing callers an allocator of their own: containers of the
+         * library and of the application share the default resource, so moves and swaps between them
+         * behave as without instrumentation. Installed before main(); a default resource set
+         * by the application afterwards is not counted.
+         */
+        inline const bool counting_default_installed = enabled && (CountingDefault(), true);
+
+        constexpr std::size_t TagBucket(std::uintmax_t tag) noexcept {
+            return tag < tag_buckets - 1 ? static_cast<std::size_t>(tag) : tag_buckets - 1;
+        }
+
+        constexpr std::size_t LengthFormIndex(std::size_t length_octets, bool indefinite) noexcept {
+            return indefinite ? 2 : length_octets > 1;
+        }
+
+        inline ErrorKind Classify(const std::exception &e) noexcept {
+            const auto *error = dynamic_cast<const DecodeError *>(&e);
+            return error != nullptr ? error->Kind() : ErrorKind::Malformed;
+        }
+
+        inline void Add(std::atomic<std::uint64_t> &counter, std::uint64_t value) noexcept {
+            counter.fetch_add(value, std::memory_order_relaxed);
+        }
+
+        inline LengthForms Load(const std::array<std::atomic<std::uint64_t>, 3> &forms) noexcept {
+            return {forms[0].load(std::memory_order_relaxed), forms[1].load(std::memory_order_relaxed),
+                    forms[2].load(std::memory_order_relaxed)};
+        }
+    }
+
+    /**
+     * Count a TLV of encoded_size octets written by an encoder.
+     */
+    inline void RecordEncoded([[maybe_unused]] std::uintmax_t universal_tag,
+                              [[maybe_unused]] std::size_t encoded_size) noexcept {
+        if constexpr(enabled) {
+            detail::Add(detail::counters.encoded_bytes[detail::TagBucket(universal_tag)], encoded_size);
+        }
+    }
+
+    inline void RecordDecoded([[maybe_unused]] std::uintmax_t universal_tag,
+                              [[maybe_unused]] std::size_t encoded_size) noexcept {
+        if constexpr(enabled) {
+            detail::Add(detail::counters.decoded_bytes[detail::TagBucket(universal_tag)], encoded_size);
+        }
+    }
+
+    /**
+     * @param length_octets number of length octets including the initial one
+     */
+    inline void RecordEncodedLength([[maybe_unused]] std::size_t length_octets,
+                                    [[maybe_unused]] bool indefinite = false) noexcept {
+        if constexpr(enabled) {
+            detail::Add(detail::counters.encoded_lengths[detail::LengthFormIndex(length_octets, indefinite)], 1);
+        }
+    }
+
+    inline void RecordDecodedLength([[maybe_unused]] std::size_t length_octets,
+                                    [[maybe_unused]] bool indefinite = false) noexcept {
+        if constexpr(enabled) {
+            detail::Add(detail::counters.decoded_lengths[detail::LengthFormIndex(length_octets, indefinite)], 1);
+        }
+    }
+
+    inline void RecordError([[maybe_unused]] ErrorKind kind) noexcept {
+        if constexpr(enabled) {
+            detail::Add(detail::counters.errors[static_cast<std::size_t>(kind)], 1);
+        }
+    }
+
+    /**
+     * Run a decoding step, counting the exception it throws (if any) by kind before passing it on.
+     */
+    template<class Fn>
+    decltype(auto) Guard(Fn &&fn) {
+        if constexpr(enabled) {
+            try {
+                return std::forward<Fn>(fn)();
+            } catch (const std::exception &e) {
+                RecordError(detail::Classify(e));
+                throw;
+            }
+        } else {
+            return std::forward<Fn>(fn)();
+        }
+    }
+
+    inline Snapshot TakeSnapshot() {
+        Snapshot result;
+        if constexpr(enabled) {
+            auto &counters = detail::counters;
+            for (std::size_t i = 0; i < tag_buckets; ++i) {
+                result.encoded_bytes[i] = counters.encoded_bytes[i].load(std::memory_order_relaxed);
+                result.decoded_bytes[i] = counters.decoded_bytes[i].load(std::memory_order_relaxed);
+            }
+            result.encoded_lengths = detail::Load(counters.encoded_lengths);
+            result.decoded_lengths = detail::Load(counters.decoded_lengths);
+            for (std::size_t i = 0; i < result.errors.size(); ++i) {
+                result.errors[i] = counters.errors[i].load(std::memory_order_relaxed);
+            }
+
+            result.default_resource = detail::CountingDefault().Stats();
+        }
+        return result;
+    }
+
+    /**
+     * Zero the tag, length and error counters. Resource statistics are cumulative.
+     */
+    inline void Reset() noexcept {
+        if constexpr(enabled) {
+            auto &counters = detail::counters;
+            for (auto *array : {&counters.encoded_bytes, &counters.decoded_bytes}) {
+                for (auto &&counter : *array) {
+                    counter.store(0, std::memory_order_relaxed);
+                }
+            }
+            for (auto *array : {&counters.encoded_lengths, &counters.decoded_lengths}) {
+                for (auto &&counter : *array) {
+                    counter.store(0, std::memory_order_relaxed);
+                }
+            }
+            for (auto &&counter : counters.errors) {
+                counter.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+#endif //BER_INSTRUMENTATION_H
@@ -0,0 +1,213 @@
+#ifndef BER_INTEGERSEQUENCE_H
+#define BER_INTEGERSEQUENCE_H
+
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "EncodedBerObject.h"
+#include "Instrumentation.h"
+#include "TlvView.h"
+
+namespace BER {
+    namespace detail {
+        template<class T>
+        constexpr bool IsBatchInteger = std::is_integral_v<T> && !std::is_same_v<T, bool> &&
+                                        sizeof(T) <= sizeof(std::uint64_t);
+
+        // identifier, short length and up to 9 contents octets
+        constexpr std::size_t max_integer_element_size = 2 + sizeof(std::uint64_t) + 1;
+
+        template<class T>
+        std::size_t IntegerSequenceContentSize(std::span<const T> values) noexcept {
+            std::size_t size = 0;
+            for (auto v : values) {
+                size += 2 + IntegralContentSize(v);
+            }
+            return size;
+        }
+
+        /**
+         * Write an INTEGER TLV with one unaligned 8-octet store.
+         * Up to 8 octets past the encoded element may be overwritten.
+         */
+        template<class T>
+        Octet *WriteIntegerElement(const T v, Octet *dst) noexcept {
+            using Wide = std::conditional_t<std::is_signed_v<T>, std::int64_t, std::uint64_t>;
+            const auto n = IntegralContentSize(v);
+            const auto u = static_cast<std::uint64_t>(static_cast<Wide>(v));
+
+            dst[0] = IdentifierOctet{
+                    IdentifierOctet::Universal,
+                    IdentifierOctet::Constructed{false},
+                    IdentifierOctet::TagNumberType{UniversalTagList::INTEGER}
+            };
+            dst[1] = LengthOctet(static_cast<Octet::value_type>(n));
+            dst += 2;
+
+            if (n > sizeof(u)) {
+                *dst++ = 0;
+                StoreBigEndian64(dst, u);
+                return dst + sizeof(u);
+            }
+            StoreBigEndian64(dst, u << (8 * (sizeof(u) - n)));
+            return dst + n;
+        }
+
+        struct WideInteger {
+            std::uint64_t bits;
+            bool negative;
+        };
+
+        /**
+         * Contents of an INTEGER of any (non-minimal) length that fits into 64 bits plus sign.
+         */
+        inline WideInteger IntegerElementContent(OctetView content) {
+            if (content.empty()) {
+                throw std::logic_error{"Empty integer"};
+            }
+            while (content.size() > 1 && ((content[0] == 0x00 && content[1] < 0x80) ||
+                                          (content[0] == 0xFF && content[1] >= 0x80))) {
+                content.remove_prefix(1);
+            }
+
+            if (content.size() == sizeof(std::uint64_t) + 1 && content[0] == 0) {
+                return {LoadBigEndian64(content.data() + 1), false};
+            }
+            if (content.size() > sizeof(std::uint64_t)) {
+                throw DecodeError{ErrorKind::Overflow, "Integer overflow"};
+            }
+
+            Octet buf[sizeof(std::uint64_t)]{};
+            std::copy(content.begin(), content.end(), buf);
+            const auto value = static_cast<std::int64_t>(LoadBigEndian64(buf)) >> (8 * (sizeof(buf) - content.size()));
+            return {static_cast<std::uint64_t>(value), value < 0};
+        }
+
+        template<class T>
+        T NarrowInteger(WideInteger value) {
+            if constexpr(std::is_unsigned_v<T>) {
+                if (value.negative || value.bits > std::numeric_limits<T>::max()) {
+                    throw DecodeError{ErrorKind::Overflow, "Integer overflow"};
+                }
+            } else {
+                const auto v = static_cast<std::int64_t>(value.bits);
+                if (value.negative ? v < std::numeric_limits<T>::min()
+                                   : value.bits > static_cast<std::uint64_t>(std::numeric_limits<T>::max())) {
+                    throw DecodeError{ErrorKind::Overflow, "Integer overflow"};
+                }
+            }
+            return static_cast<T>(value.bits);
+        }
+    }
+
+    template<class T, typename = std::enable_if_t<detail::IsBatchInteger<T>>>
+    std::size_t IntegerSequenceEncodedSize(std::span<const T> values) noexcept {
+        const auto content_sz = detail::IntegerSequenceContentSize(values);
+        return 1 + detail::LengthSize(content_sz) + content_sz;
+    }
+
+    /**
+     * Encode values as SEQUENCE OF INTEGER into caller-supplied storage.
+     * Element widths are computed up front from the leading zero/one count, each element is then written
+     * with a single 8-octet big-endian store while there is room for it.
+     * @return number of written octets
+     */
+    template<class T, typename = std::enable_if_t<detail::IsBatchInteger<T>>>
+    std::size_t EncodeIntegerSequenceTo(std::span<const T> values, std::span<Octet> out) {
+        const auto content_sz = detail::IntegerSequenceContentSize(values);
+        const auto total = 1 + detail::LengthSize(content_sz) + content_sz;
+        if (out.size() < total) {
+            throw std::length_error{"Buffer is too small"};
+        }
+
+        Instrumentation::RecordEncoded(UniversalTagList::SEQUENCE, total);
+        Octet *dst = out.data();
+        Octet *const limit = out.data() + out.size();
+
+        *dst++ = IdentifierOctet{
+                IdentifierOctet::Universal,
+                IdentifierOctet::Constructed{true},
+                IdentifierOctet::TagNumberType{UniversalTagList::SEQUENCE}
+        };
+        dst = detail::WriteLength(content_sz, dst);
+
+        for (auto v : values) {
+            if (limit - dst >= static_cast<std::ptrdiff_t>(detail::max_integer_element_size + sizeof(std::uint64_t))) {
+                dst = detail::WriteIntegerElement(v, dst);
+            } else {
+                dst = detail::EncodeIntegral(v, dst);
+            }
+        }
+
+        return total;
+    }
+
+    template<class T, typename = std::enable_if_t<detail::IsBatchInteger<T>>>
+    EncodedBerObject EncodeIntegerSequence(std::span<const T> values,
+                                           std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+        // slack keeps every element on the wide-store path
+        EncodedBerObject result(IntegerSequenceEncodedSize(values) + detail::max_integer_element_size +
+                                sizeof(std::uint64_t), resource);
+        result.resize(EncodeIntegerSequenceTo(values, std::span<Octet>(result)));
+        return result;
+    }
+
+    /**
+     * Decode SEQUENCE OF INTEGER into caller-supplied storage.
+     * Elements with short-form length are read with a single 8-octet load and an arithmetic shift.
+     * @return number of decoded elements
+     */
+    template<class T, typename = std::enable_if_t<detail::IsBatchInteger<T>>>
+    std::size_t DecodeIntegerSequence(OctetView encoded, std::span<T> out) {
+        const TlvView tlv{encoded};
+        if (!tlv.IsUniversal(UniversalTagList::SEQUENCE) || !tlv.IsConstructed()) {
+            throw std::logic_error{"SEQUENCE is expected"};
+        }
+
+        const auto content = tlv.Content();
+        const Octet *src = content.data();
+        const Octet *const end = content.data() + content.size();
+        std::size_t count = 0;
+
+        while (src != end) {
+            if (count == out.size()) {
+                throw std::length_error{"Buffer is too small"};
+            }
+
+            const auto n = static_cast<std::size_t>(end - src) >= 2 + sizeof(std::uint64_t) ? src[1].octet_ : 0;
+            if (src[0] == UniversalTagList::INTEGER && n >= 1 && n <= sizeof(std::uint64_t)) {
+                const auto value = static_cast<std::int64_t>(LoadBigEndian64(src + 2)) >> (8 * (sizeof(std::uint64_t) - n));
+                out[count++] = detail::NarrowInteger<T>({static_cast<std::uint64_t>(value), value < 0});
+                src += 2 + n;
+            } else {
+                const TlvView element{OctetView(src, end - src)};
+                if (!element.IsUniversal(UniversalTagList::INTEGER) || element.IsConstructed()) {
+                    throw std::logic_error{"INTEGER is expected"};
+                }
+                out[count++] = detail::NarrowInteger<T>(detail::IntegerElementContent(element.Content()));
+                src += element.Bytes().size();
+            }
+        }
+
+        return count;
+    }
+
+    template<class T, typename = std::enable_if_t<detail::IsBatchInteger<T>>>
+    std::pmr::vector<T> DecodeIntegerSequence(OctetView encoded,
+                                              std::pmr::memory_resource *resource = std::pmr::get_default_resource()) {
+        // every element takes at least 3 octets
+        std::pmr::vector<T> result(encoded.size() / 3, resource);
+        result.resize(DecodeIntegerSequence(encoded, std::span<T>(result)));
+        return result;
+    }
+}
+
+#endif //BER_INTEGERSEQUENCE_H
@@ -0,0 +1,254 @@
+#ifndef BER_OBJECTIDENTIFIER_H
+#define BER_OBJECTIDENTIFIER_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "EncodedBerObject.h"
+#include "Instrumentation.h"
+#include "TlvView.h"
+
+namespace BER {
+    struct ObjectIdentifier {
+        std::vector<std::uint64_t> arcs;
+
+        friend bool operator==(const ObjectIdentifier &, const ObjectIdentifier &) = default;
+    };
+
+    struct RelativeOid {
+        std::vector<std::uint64_t> arcs;
+
+        friend bool operator==(const RelativeOid &, const RelativeOid &) = default;
+    };
+
+    namespace detail {
+        constexpr std::uint64_t continuation_bits = 0x8080808080808080ull;
+
+        /**
+         * Gather the 7-bit groups of a base-128 number of len (1..8) octets loaded little-endian into word.
+         */
+        constexpr std::uint64_t GatherBase128(std::uint64_t word, unsigned len) noexcept {
+            if (len < 8) {
+                word &= (std::uint64_t{1} << (8 * len)) - 1;
+            }
+            word = ByteSwap(word & ~continuation_bits) >> (8 * (8 - len));
+            word = (word & 0x007F007F007F007Full) | ((word & 0x7F007F007F007F00ull) >> 1);
+            word = (word & 0x00003FFF00003FFFull) | ((word & 0x3FFF00003FFF0000ull) >> 2);
+            return (word & 0x000000000FFFFFFFull) | ((word & 0x0FFFFFFF00000000ull) >> 4);
+        }
+
+        /**
+         * Scalar decoding of one base-128 number, used for tails and numbers longer than 8 octets.
+         */
+        inline std::size_t DecodeBase128Slow(const Octet *src, const Octet *end, std::uint64_t &value) {
+            if (*src == 0x80) {
+                throw std::logic_error{"Non-minimal subidentifier"};
+            }
+            value = 0;
+            for (const Octet *p = src; p != end; ++p) {
+                if (value > (std::numeric_limits<std::uint64_t>::max() >> 7)) {
+                    throw DecodeError{ErrorKind::Overflow, "Integer overflow"};
+                }
+                value = (value << 7) | (*p & 0x7F);
+                if ((*p & 0x80) == 0) {
+                    return p - src + 1;
+                }
+            }
+            throw DecodeError{ErrorKind::Truncated, "Truncated subidentifier"};
+        }
+
+        /**
+         * Decode a run of base-128 numbers. An 8-octet word is loaded at a time:
+         * a word without continuation bits yields 8 numbers at once, otherwise the position of the first
+         * terminating octet gives the length of the next number and its groups are gathered without a loop.
+         * @param out receives decoded numbers, may be nullptr to only count them
+         * @return number of decoded numbers
+         */
+        inline std::size_t DecodeBase128(OctetView content, std::uint64_t *out) {
+            const Octet *src = content.data();
+            const Octet *const end = src + content.size();
+            std::size_t count = 0;
+
+            while (end - src >= 8) {
+                std::uint64_t word;
+                std::memcpy(&word, src, sizeof(word));
+                if constexpr(std::endian::native == std::endian::big) {
+                    word = ByteSwap(word);
+                }
+
+                const auto cont = word & continuation_bits;
+                if (cont == 0) {
+                    if (out != nullptr) {
+                        for (int i = 0; i < 8; ++i) {
+                            out[count + i] = (word >> (8 * i)) & 0x7F;
+                        }
+                    }
+                    count += 8;
+                    src += 8;
+                    continue;
+                }
+
+                const auto stop = ~word & continuation_bits;
+                if (stop == 0) {
+                    std::uint64_t value;
+                    src += DecodeBase128Slow(src, end, value);
+                    if (out != nullptr) {
+                        out[count] = value;
+                    }
+                    ++count;
+                    continue;
+                }
+
+                if ((word & 0xFF) == 0x80) {
+                    throw std::logic_error{"Non-minimal subidentifier"};
+                }
+                const auto len = static_cast<unsigned>(std::countr_zero(stop)) / 8 + 1;
+                if (out != nullptr) {
+                    out[count] = GatherBase128(word, len);
+                }
+                ++count;
+                src += len;
+            }
+
+            while (src != end) {
+                std::uint64_t value;
+                src += DecodeBase128Slow(src, end, value);
+                if (out != nullptr) {
+                    out[count] = value;
+                }
+                ++count;
+            }
+
+            return count;
+        }
+
+        /**
+         * First subidentifier of an OBJECT IDENTIFIER combines the first two arcs.
+         */
+        inline std::uint64_t FirstSubidentifier(std::span<const std::uint64_t> arcs) {
+            if (arcs.size() < 2 || arcs[0] > 2 || (arcs[0] < 2 && arcs[1] >= 40) ||
+                arcs[1] > std::numeric_limits<std::uint64_t>::max() - 80) {
+                throw std::logic_error{"Malformed OBJECT IDENTIFIER"};
+            }
+            return arcs[0] * 40 + arcs[1];
+        }
+
+        inline std::size_t SubidentifiersSize(std::span<const std::uint64_t> subidentifiers) noexcept {
+            std::size_t size = 0;
+            for (auto v : subidentifiers) {
+                size += Base128Size(v);
+            }
+            return size;
+        }
+
+        inline std::size_t ObjectIdentifierContentSize(std::span<const std::uint64_t> arcs) {
+            return Base128Size(FirstSubidentifier(arcs)) + SubidentifiersSize(arcs.subspan(2));
+        }
+
+        template<class OutputIt>
+        OutputIt WriteOidTlv(UniversalTagList::Type tag, std::size_t content_sz, OutputIt out) {
+            Instrumentation::RecordEncoded(tag, 1 + LengthSize(content_sz) + content_sz);
+            *out++ = IdentifierOctet{
+                    IdentifierOctet::Universal,
+                    IdentifierOctet::Constructed{false},
+                    IdentifierOctet::TagNumberType{tag}
+            };
+            return WriteLength(content_sz, out);
+        }
+    }
+
+    inline std::size_t EncodedSize(const ObjectIdentifier &oid) {
+        const auto content_sz = detail::ObjectIdentifierContentSize(oid.arcs);
+        return 1 + detail::LengthSize(content_sz) + content_sz;
+    }
+
+    inline std::size_t EncodedSize(const RelativeOid &oid) {
+        const auto content_sz = detail::SubidentifiersSize(oid.arcs);
+        return 1 + detail::LengthSize(content_sz) + content_sz;
+    }
+
+    template<class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(const ObjectIdentifier &oid, OutputIt out) {
+        const std::span<const std::uint64_t> arcs{oid.arcs};
+        out = detail::WriteOidTlv(UniversalTagList::OBJECT_IDENTIFIER, detail::ObjectIdentifierContentSize(arcs), out);
+        out = detail::WriteBase128(detail::FirstSubidentifier(arcs), out);
+        for (auto arc : arcs.subspan(2)) {
+            out = detail::WriteBase128(arc, out);
+        }
+        return out;
+    }
+
+    template<class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(const RelativeOid &oid, OutputIt out) {
+        out = detail::WriteOidTlv(UniversalTagList::RELATIVE_OID, detail::SubidentifiersSize(oid.arcs), out);
+        for (auto arc : oid.arcs) {
+            out = detail::WriteBase128(arc, out);
+        }
+        return out;
+    }
+
+    inline EncodedBerObject Encode(const ObjectIdentifier &oid) {
+        EncodedBerObject result(EncodedSize(oid));
+        EncodeTo(oid, result.data());
+        return result;
+    }
+
+    inline EncodedBerObject Encode(const RelativeOid &oid) {
+        EncodedBerObject result(EncodedSize(oid));
+        EncodeTo(oid, result.data());
+        return result;
+    }
+
+    /**
+     * Decode OBJECT IDENTIFIER contents octets.
+     */
+    inline ObjectIdentifier DecodeObjectIdentifierContent(OctetView content) {
+        if (content.empty()) {
+            throw std::logic_error{"Empty OBJECT IDENTIFIER"};
+        }
+
+        ObjectIdentifier result;
+        result.arcs.resize(content.size() + 1);
+        const auto count = detail::DecodeBase128(content, result.arcs.data() + 1);
+        result.arcs.resize(count + 1);
+
+        const auto first = result.arcs[1];
+        result.arcs[0] = first < 80 ? first / 40 : 2;
+        result.arcs[1] = first - result.arcs[0] * 40;
+        return result;
+    }
+
+    /**
+     * Decode RELATIVE-OID contents octets.
+     */
+    inline RelativeOid DecodeRelativeOidContent(OctetView content) {
+        if (content.empty()) {
+            throw std::logic_error{"Empty RELATIVE-OID"};
+        }
+
+        RelativeOid result;
+        result.arcs.resize(content.size());
+        result.arcs.resize(detail::DecodeBase128(content, result.arcs.data()));
+        return result;
+    }
+
+    /**
+     * Prefix test on encoded contents octets, e.g. TlvView::Content() of two OBJECT IDENTIFIERs.
+     * Subidentifiers are self-delimiting, so an octet-wise prefix is an arc-wise prefix.
+     */
+    inline bool OidStartsWith(OctetView oid, OctetView prefix) noexcept {
+        return prefix.size() <= oid.size() &&
+               (prefix.empty() || std::memcmp(oid.data(), prefix.data(), prefix.size()) == 0);
+    }
+}
+
+#endif //BER_OBJECTIDENTIFIER_H
@@ -2,10 +2,14 @@
 #define BER_OCTET_H
 
 #include <climits>
+#include <cstddef>
 #include <numeric>
 #include <memory_resource>
 #include <cassert>
+#include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 #include "Util.h"
 
@@ -38,19 +42,44 @@ namespace BER {
             static_assert(Start < CHAR_BIT * sizeof(value_type));
             static_assert(End < CHAR_BIT * sizeof(value_type));
 
-            return {(octet_ << (CHAR_BIT * sizeof(value_type) - Start) >> (CHAR_BIT * sizeof(value_type) - Start))
-                            >> End};
+            return {(octet_ >> End) & ((1 << (Start - End + 1)) - 1)};
         }
     };
 
+    static_assert(sizeof(Octet) == 1 && alignof(Octet) == 1 && std::is_trivially_copyable_v<Octet>,
+                  "byte buffers are reinterpreted as octets");
+
     using OctetView = std::basic_string_view<Octet>;
     using OctetString = std::basic_string<Octet>;
 
+    /**
+     * Octets of a byte buffer, nothing is copied.
+     */
+    inline OctetView AsOctetView(const unsigned char *data, std::size_t size) noexcept {
+        return {reinterpret_cast<const Octet *>(data), size};
+    }
+
+    inline OctetView AsOctetView(std::span<const std::byte> bytes) noexcept {
+        return {reinterpret_cast<const Octet *>(bytes.data()), bytes.size()};
+    }
+
+    inline OctetView AsOctetView(std::string_view str) noexcept {
+        return {reinterpret_cast<const Octet *>(str.data()), str.size()};
+    }
+
+    inline std::span<const std::byte> AsBytes(OctetView view) noexcept {
+        return {reinterpret_cast<const std::byte *>(view.data()), view.size()};
+    }
+
+    inline std::string_view AsStringView(OctetView view) noexcept {
+        return {reinterpret_cast<const char *>(view.data()), view.size()};
+    }
+
     template<std::size_t S>
     using OctetBits = Octet::bits_type<S>;
 
     template<std::size_t... Sizes>
-    Octet PackOctet(OctetBits<Sizes>... args) {
+    constexpr Octet PackOctet(OctetBits<Sizes>... args) {
         static_assert((Sizes + ...) <= CHAR_BIT * sizeof(Octet::value_type));
 
         auto shift = CHAR_BIT * sizeof(Octet::value_type);
@@ -64,14 +93,8 @@ namespace BER {
         });
     }
 
-    OctetString FromString(std::string_view view) {
-        OctetString result;
-
-        for (auto &&el : view) {
-            result.push_back(el);
-        }
-
-        return result;
+    inline OctetString FromString(std::string_view view) {
+        return OctetString{AsOctetView(view)};
     }
 }
 
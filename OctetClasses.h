@@ -1,6 +1,10 @@
 #ifndef BER_OCTETCLASSES_H
 #define BER_OCTETCLASSES_H
 
+#include <algorithm>
+
+#include "Instrumentation.h"
+
 namespace BER {
     class SubsequentIdOctet;
 
@@ -20,7 +24,7 @@ namespace BER {
 
         using Octet::Octet;
 
-        IdentifierOctet(ClassTagType class_tag, Constructed primitive, TagNumberType tag_num) :
+        constexpr IdentifierOctet(ClassTagType class_tag, Constructed primitive, TagNumberType tag_num) :
                 Octet{PackOctet(class_tag, primitive, tag_num)} {}
 
         [[nodiscard]] constexpr ClassTagType ClassTag() const noexcept {
@@ -31,6 +35,10 @@ namespace BER {
             return SubBits<5, 5>();
         }
 
+        [[nodiscard]] constexpr bool IsConstructed() const noexcept {
+            return SubBits<5, 5>() == 1;
+        }
+
         [[nodiscard]] constexpr TagNumberType TagNumber() const noexcept {
             return SubBits<4, 0>();
         }
@@ -52,7 +60,7 @@ namespace BER {
         }
 
         [[nodiscard]] constexpr bool IsEnd() const noexcept {
-            return SubBits<7, 7>() != 0;
+            return SubBits<7, 7>() == 0;
         }
     };
 
@@ -63,7 +71,7 @@ namespace BER {
         using Octet::Octet;
 
         [[nodiscard]] constexpr bool IsInDefinite() const noexcept {
-            return SubBits<7, 7>() == 1 && SubBits<6, 1>() == 0;
+            return SubBits<7, 7>() == 1 && SubBits<6, 0>() == 0;
         }
 
         [[nodiscard]] constexpr bool IsShort() const noexcept {
@@ -94,32 +102,28 @@ namespace BER {
         ContentsOctetList sub_octets;
 
         [[nodiscard]] value_type size() const {
-            if (sub_octets.size() > sizeof(value_type)) {
-                throw std::logic_error{"Integer overflow"};
-            }
-
             if (main_octet.IsShort()) {
                 return main_octet.Data();
             }
 
-            return DecodeIntegralImpl({&sub_octets[0], sub_octets.size()});
+            if (sub_octets.size() > sizeof(value_type)) {
+                throw DecodeError{ErrorKind::Overflow, "Integer overflow"};
+            }
+
+            return DecodeIntegralImpl({sub_octets.data(), sub_octets.size()});
         }
 
+        /**
+         * Long-form length octets are an unsigned big-endian number.
+         */
         static value_type DecodeIntegralImpl(OctetView encoded) {
-            value_type result = 0;
-            bool neg = false;
-
-            if (encoded[0].SubBits<7, 7>() == 1) {
-                neg = true;
-            }
-
-            for (int i = 0; i < encoded.size() && (result <<= 8, 1); ++i) {
-                result += (neg ? ~encoded[i].SubBits<7, 0>() : encoded[i].SubBits<7, 0>());
+            if (encoded.empty()) {
+                throw DecodeError{ErrorKind::Truncated, "Truncated length"};
             }
 
-            if (neg) {
-                ++result;
-                result *= -1;
+            value_type result = 0;
+            for (auto &&el : encoded) {
+                result = (result << 8) | el.SubBits<7, 0>().value;
             }
 
             return result;
@@ -148,18 +152,29 @@ namespace BER {
         }
 
         static LengthOctets Encode(value_type length) {
-            if (length < 127) {
-                return {length, {}};
+            if (length < 128) {
+                return {static_cast<Octet::value_type>(length), {}};
             }
-            auto content = IntegralContent(length);
-            if (content.size() >= 127) {
-                throw std::logic_error{"Integer overflow"};
+
+            ContentsOctetList content;
+            for (auto t = length; t != 0; t >>= 8) {
+                content.push_back(t & 0xFF);
             }
+            std::reverse(content.begin(), content.end());
 
-            return {0x80 | content.size(), content};
+            return {static_cast<Octet::value_type>(0x80 | content.size()), content};
         }
     };
 
+    struct TlvHeader {
+        IdentifierOctet identifier{0};
+        std::uintmax_t tag_number{};
+        std::uintmax_t length{}; // meaningless if indefinite
+        std::size_t header_size{};
+        bool indefinite{};
+        std::uint8_t identifier_size{}; // the length octets follow
+    };
+
     struct ContentOctet : public Octet {
         ContentOctet() = default;
 
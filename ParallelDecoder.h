@@ -0,0 +1,254 @@
+#ifndef BER_PARALLELDECODER_H
+#define BER_PARALLELDECODER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "TlvView.h"
+#include "DecodedDocument.h"
+
+namespace BER {
+    /**
+     * Split pass over concatenated TLVs, only identifier and length octets are read.
+     */
+    inline std::vector<OctetView> SplitRecords(OctetView stream) {
+        std::vector<OctetView> result;
+        while (!stream.empty()) {
+            const TlvView tlv{stream};
+            result.push_back(tlv.Bytes());
+            stream.remove_prefix(tlv.Bytes().size());
+        }
+        return result;
+    }
+
+    /**
+     * Split pass over the elements of a constructed TLV, e.g. a SEQUENCE OF.
+     */
+    inline std::vector<OctetView> SplitElements(const TlvView &tlv) {
+        std::vector<OctetView> result;
+        for (auto &&child : tlv.Children()) {
+            result.push_back(child.Bytes());
+        }
+        return result;
+    }
+
+    /**
+     * Pool of worker threads decoding independent elements. Elements are grouped into tasks of about
+     * grain_bytes, every worker takes tasks from the back of its own deque and steals from the front
+     * of the others' when it runs dry. Each worker allocates from its own DocumentArena.
+     */
+    class ParallelDecoder {
+        struct Task {
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        struct Worker {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+            DocumentArena arena;
+        };
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::vector<std::thread> threads_;
+        std::size_t grain_bytes_;
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        std::size_t generation_{};
+        bool stop_{};
+
+        std::function<void(std::size_t, std::size_t, Worker &)> job_;
+        std::atomic<std::size_t> remaining_{};
+        std::exception_ptr error_;
+
+        std::optional<Task> Pop(std::size_t self) {
+            {
+                auto &own = *workers_[self];
+                std::lock_guard lock{own.mutex};
+                if (!own.tasks.empty()) {
+                    const auto task = own.tasks.back();
+                    own.tasks.pop_back();
+                    return task;
+                }
+            }
+            for (std::size_t i = 1; i < workers_.size(); ++i) {
+                auto &victim = *workers_[(self + i) % workers_.size()];
+                std::lock_guard lock{victim.mutex};
+                if (!victim.tasks.empty()) {
+                    const auto task = victim.tasks.front();
+                    victim.tasks.pop_front();
+                    return task;
+                }
+            }
+            return std::nullopt;
+        }
+
+        void Run(std::size_t self) {
+            std::size_t seen = 0;
+            for (;;) {
+                {
+                    std::unique_lock lock{mutex_};
+                    wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                    if (stop_) {
+                        return;
+                    }
+                    seen = generation_;
+                }
+
+                while (auto task = Pop(self)) {
+                    try {
+                        job_(task->begin, task->end, *workers_[self]);
+                    } catch (...) {
+                        std::lock_guard lock{mutex_};
+                        if (!error_) {
+                            error_ = std::current_exception();
+                        }
+                    }
+                    if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                        std::lock_guard lock{mutex_};
+                        done_.notify_all();
+                    }
+                }
+            }
+        }
+
+    public:
+        /**
+         * @param threads number of workers, the hardware concurrency by default
+         * @param grain_bytes encoded size of a task, small elements are decoded in batches
+         */
+        explicit ParallelDecoder(std::size_t threads = 0, std::size_t grain_bytes = 64 * 1024) :
+                grain_bytes_(std::max<std::size_t>(grain_bytes, 1)) {
+            if (threads == 0) {
+                threads = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+            for (std::size_t i = 0; i < threads; ++i) {
+                workers_.push_back(std::make_unique<Worker>());
+            }
+            for (std::size_t i = 0; i < threads; ++i) {
+                threads_.emplace_back([this, i] { Run(i); });
+            }
+        }
+
+        ParallelDecoder(const ParallelDecoder &) = delete;
+
+        ParallelDecoder &operator=(const ParallelDecoder &) = delete;
+
+        ~ParallelDecoder() {
+            {
+                std::lock_guard lock{mutex_};
+                stop_ = true;
+            }
+            wake_.notify_all();
+            for (auto &&thread : threads_) {
+                thread.join();
+            }
+        }
+
+        [[nodiscard]] std::size_t Threads() const noexcept {
+            return workers_.size();
+        }
+
+        /**
+         * Decode every element with fn(OctetView, std::pmr::memory_resource*), results are in input order.
+         * Memory handed to fn belongs to the worker's arena and stays valid until Release().
+         * The first exception thrown by fn is rethrown once all tasks are finished.
+         */
+        template<class Fn>
+        auto Decode(std::span<const OctetView> elements, Fn &&fn) {
+            using Result = std::invoke_result_t<Fn &, OctetView, std::pmr::memory_resource *>;
+            std::vector<std::optional<Result>> slots(elements.size());
+
+            std::vector<Task> tasks;
+            for (std::size_t begin = 0; begin < elements.size();) {
+                std::size_t end = begin;
+                std::size_t bytes = 0;
+                while (end < elements.size() && bytes < grain_bytes_) {
+                    bytes += elements[end++].size();
+                }
+                tasks.push_back({begin, end});
+                begin = end;
+            }
+            if (tasks.empty()) {
+                return std::vector<Result>{};
+            }
+
+            job_ = [&](std::size_t begin, std::size_t end, Worker &worker) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    slots[i].emplace(fn(elements[i], worker.arena.Resource()));
+                }
+            };
+            error_ = nullptr;
+            remaining_.store(tasks.size(), std::memory_order_relaxed);
+
+            // Contiguous blocks per worker, so a worker walks adjacent memory until it has to steal.
+            const auto per_worker = (tasks.size() + workers_.size() - 1) / workers_.size();
+            for (std::size_t w = 0; w < workers_.size(); ++w) {
+                const auto first = std::min(tasks.size(), w * per_worker);
+                const auto last = std::min(tasks.size(), first + per_worker);
+                std::lock_guard lock{workers_[w]->mutex};
+                // Owners pop from the back, so push in reverse to start at the block's beginning.
+                for (auto i = last; i > first; --i) {
+                    workers_[w]->tasks.push_back(tasks[i - 1]);
+                }
+            }
+
+            {
+                std::unique_lock lock{mutex_};
+                ++generation_;
+                wake_.notify_all();
+                done_.wait(lock, [&] { return remaining_.load(std::memory_order_acquire) == 0; });
+            }
+            job_ = nullptr;
+
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+
+            std::vector<Result> result;
+            result.reserve(slots.size());
+            for (auto &&slot : slots) {
+                result.push_back(std::move(*slot));
+            }
+            return result;
+        }
+
+        /**
+         * Decode every element into a DecodedDocument borrowing the input, which shall outlive the results.
+         */
+        std::vector<DecodedDocument> Decode(std::span<const OctetView> elements) {
+            return Decode(elements, [](OctetView element, std::pmr::memory_resource *resource) {
+                return DecodedDocument{element, resource, true};
+            });
+        }
+
+        /**
+         * Drop everything decoded so far, the arenas are reused by the next Decode().
+         */
+        void Release() {
+            for (auto &&worker : workers_) {
+                worker->arena.Release();
+            }
+        }
+    };
+}
+
+#endif //BER_PARALLELDECODER_H
@@ -0,0 +1,359 @@
+#ifndef BER_SCHEMA_H
+#define BER_SCHEMA_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "EncodedBerObject.h"
+#include "Instrumentation.h"
+#include "DecodedBerObject.h"
+#include "IntegerSequence.h"
+#include "HeaderParser.h"
+#include "TlvView.h"
+
+namespace BER {
+    /**
+     * Field of a schema: data member Member encoded with the context-specific implicit tag [Tag].
+     */
+    template<auto Member, std::uintmax_t Tag>
+    struct Field {
+        static constexpr auto member = Member;
+        static constexpr std::uintmax_t tag = Tag;
+    };
+
+    template<class... Fields>
+    struct FieldList {
+    };
+
+    /**
+     * Specialize for a struct to bind it to SEQUENCE { [Tag] IMPLICIT field, ... }:
+     *
+     *     template<> struct BerSchema<Cdr> {
+     *         using fields = FieldList<Field<&Cdr::id, 0>, Field<&Cdr::duration, 1>, Field<&Cdr::caller, 2>>;
+     *     };
+     *
+     * Supported member types are bool, integral and floating point types, std::string, OctetString,
+     * other structs with a schema and std::optional of those (absent fields are omitted).
+     */
+    template<class T>
+    struct BerSchema;
+
+    namespace detail {
+        template<class T, class = void>
+        constexpr bool HasSchema = false;
+
+        template<class T>
+        constexpr bool HasSchema<T, std::void_t<typename BerSchema<T>::fields>> = true;
+
+        template<class T>
+        struct IsOptional : std::false_type {
+            using value_type = T;
+        };
+
+        template<class T>
+        struct IsOptional<std::optional<T>> : std::true_type {
+            using value_type = T;
+        };
+
+        template<class F, class S>
+        using FieldType = std::remove_cvref_t<decltype(std::declval<S &>().*F::member)>;
+
+        /**
+         * Contents' codec of a field's value, the identifier octets come from the schema.
+         */
+        template<class V, class = void>
+        struct FieldCodec;
+
+        template<>
+        struct FieldCodec<bool> {
+            static constexpr bool constructed = false;
+            static constexpr std::optional<std::size_t> max_size = 1;
+
+            static constexpr std::size_t ContentSize(bool) noexcept {
+                return 1;
+            }
+
+            template<class OutputIt>
+            static OutputIt WriteContent(bool v, OutputIt out) {
+                *out++ = ContentOctet{v};
+                return out;
+            }
+
+            static void ReadContent(const TlvView &tlv, bool &v) {
+                if (tlv.Content().size() != 1) {
+                    throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+                }
+                v = tlv.Content()[0] != 0;
+            }
+        };
+
+        template<class V>
+        struct FieldCodec<V, std::enable_if_t<IsBatchInteger<V>>> {
+            static constexpr bool constructed = false;
+            static constexpr std::optional<std::size_t> max_size = sizeof(V) + std::is_unsigned_v<V>;
+
+            static constexpr std::size_t ContentSize(V v) noexcept {
+                return IntegralContentSize(v);
+            }
+
+            template<class OutputIt>
+            static OutputIt WriteContent(V v, OutputIt out) {
+                return WriteIntegralContent(v, IntegralContentSize(v), out);
+            }
+
+            static void ReadContent(const TlvView &tlv, V &v) {
+                v = NarrowInteger<V>(IntegerElementContent(tlv.Content()));
+            }
+        };
+
+        template<class V>
+        struct FieldCodec<V, std::enable_if_t<std::is_floating_point_v<V>>> {
+            static constexpr bool constructed = false;
+            static constexpr std::optional<std::size_t> max_size =
+                    1 + std::max(IntegralContentSize(std::numeric_limits<V>::min_exponent - std::numeric_limits<V>::digits),
+                                 IntegralContentSize(std::numeric_limits<V>::max_exponent)) +
+                    (std::numeric_limits<V>::digits + 7) / 8;
+
+            static constexpr std::size_t ContentSize(V v) noexcept {
+                return DecomposeReal(v).ContentSize();
+            }
+
+            template<class OutputIt>
+            static OutputIt WriteContent(V v, OutputIt out) {
+                return WriteRealContent(DecomposeReal(v), out);
+            }
+
+            static void ReadContent(const TlvView &tlv, V &v) {
+                v = static_cast<V>(DecodeRealImpl(tlv.Content()));
+            }
+        };
+
+        template<class V>
+        struct FieldCodec<V, std::enable_if_t<std::is_same_v<V, std::string> || std::is_same_v<V, OctetString>>> {
+            static constexpr bool constructed = false;
+            static constexpr std::optional<std::size_t> max_size = std::nullopt;
+
+            static std::size_t ContentSize(const V &v) noexcept {
+                return v.size();
+            }
+
+            template<class OutputIt>
+            static OutputIt WriteContent(const V &v, OutputIt out) {
+                return std::transform(v.begin(), v.end(), out, [](auto el) {
+                    return Octet(static_cast<Octet::value_type>(el));
+                });
+            }
+
+            static void ReadContent(const TlvView &tlv, V &v) {
+                const auto content = tlv.Content();
+                v.assign(content.begin(), content.end());
+            }
+        };
+
+        template<class S>
+        struct SchemaCodec;
+
+        template<class V>
+        struct FieldCodec<V, std::enable_if_t<HasSchema<V>>> {
+            static constexpr bool constructed = true;
+            static constexpr std::optional<std::size_t> max_size = SchemaCodec<V>::max_content_size;
+
+            static std::size_t ContentSize(const V &v) {
+                return SchemaCodec<V>::ContentSize(v);
+            }
+
+            template<class OutputIt>
+            static OutputIt WriteContent(const V &v, OutputIt out) {
+                return SchemaCodec<V>::WriteContent(v, out);
+            }
+
+            static void ReadContent(const TlvView &tlv, V &v) {
+                SchemaCodec<V>::ReadContent(tlv, v);
+            }
+        };
+
+        template<class F, class S>
+        struct FieldBinding {
+            using Value = FieldType<F, S>;
+            static constexpr bool optional = IsOptional<Value>::value;
+            using Codec = FieldCodec<typename IsOptional<Value>::value_type>;
+
+            static constexpr auto identifier = [] {
+                std::array<Octet, IdentifierSize(F::tag)> result{};
+                WriteIdentifier(IdentifierOctet::ContextSpecific, Codec::constructed, F::tag, result.begin());
+                return result;
+            }();
+
+            static constexpr std::optional<std::size_t> max_size = [] {
+                std::optional<std::size_t> result;
+                if (Codec::max_size) {
+                    result = identifier.size() + LengthSize(*Codec::max_size) + *Codec::max_size;
+                }
+                return result;
+            }();
+
+            static std::size_t EncodedSize(const S &s) {
+                const auto &v = s.*F::member;
+                if constexpr(optional) {
+                    if (!v) {
+                        return 0;
+                    }
+                    const auto content_sz = Codec::ContentSize(*v);
+                    return identifier.size() + LengthSize(content_sz) + content_sz;
+                } else {
+                    const auto content_sz = Codec::ContentSize(v);
+                    return identifier.size() + LengthSize(content_sz) + content_sz;
+                }
+            }
+
+            template<class OutputIt>
+            static OutputIt Write(const S &s, OutputIt out) {
+                const auto &v = s.*F::member;
+                if constexpr(optional) {
+                    if (!v) {
+                        return out;
+                    }
+                    out = std::copy(identifier.begin(), identifier.end(), out);
+                    out = WriteLength(Codec::ContentSize(*v), out);
+                    return Codec::WriteContent(*v, out);
+                } else {
+                    out = std::copy(identifier.begin(), identifier.end(), out);
+                    out = WriteLength(Codec::ContentSize(v), out);
+                    return Codec::WriteContent(v, out);
+                }
+            }
+
+            static bool Matches(const TlvView &tlv) noexcept {
+                return tlv.ClassTag().value == IdentifierOctet::ContextSpecific.value && tlv.TagNumber() == F::tag &&
+                       tlv.IsConstructed() == Codec::constructed;
+            }
+
+            /**
+             * Read the field from *it if it matches, advancing it.
+             */
+            static void Read(TlvIterator &it, const TlvIterator &end, S &s) {
+                auto &v = s.*F::member;
+                if (it == end || !Matches(*it)) {
+                    if constexpr(optional) {
+                        v.reset();
+                        return;
+                    } else {
+                        throw std::logic_error{"Missing field"};
+                    }
+                }
+                if constexpr(optional) {
+                    Codec::ReadContent(*it, v.emplace());
+                } else {
+                    Codec::ReadContent(*it, v);
+                }
+                ++it;
+            }
+        };
+
+        template<class S, class List = typename BerSchema<S>::fields>
+        struct SchemaFields;
+
+        template<class S, class... Fields>
+        struct SchemaFields<S, FieldList<Fields...>> {
+            static constexpr std::optional<std::size_t> max_content_size = [] {
+                std::optional<std::size_t> result{0};
+                ((result = result && FieldBinding<Fields, S>::max_size
+                           ? std::optional<std::size_t>{*result + *FieldBinding<Fields, S>::max_size}
+                           : std::nullopt), ...);
+                return result;
+            }();
+
+            static std::size_t ContentSize(const S &s) {
+                return (std::size_t{0} + ... + FieldBinding<Fields, S>::EncodedSize(s));
+            }
+
+            template<class OutputIt>
+            static OutputIt WriteContent(const S &s, OutputIt out) {
+                ((out = FieldBinding<Fields, S>::Write(s, out)), ...);
+                return out;
+            }
+
+            static void ReadContent(const TlvView &tlv, S &s) {
+                const auto children = tlv.Children();
+                auto it = children.begin();
+                const auto end = children.end();
+                (FieldBinding<Fields, S>::Read(it, end, s), ...);
+            }
+        };
+
+        template<class S>
+        struct SchemaCodec : SchemaFields<S> {
+        };
+
+        constexpr std::array<Octet, 1> sequence_identifier{
+                IdentifierOctet{IdentifierOctet::Universal, IdentifierOctet::Constructed{true},
+                                IdentifierOctet::TagNumberType{UniversalTagList::SEQUENCE}}
+        };
+    }
+
+    /**
+     * Upper bound of the encoded size of a schema whose fields all have a bounded size.
+     */
+    template<class S, typename = std::enable_if_t<detail::HasSchema<S> &&
+                                                  detail::SchemaCodec<S>::max_content_size.has_value()>>
+    inline constexpr std::size_t max_encoded_size = 1 + detail::LengthSize(*detail::SchemaCodec<S>::max_content_size) +
+                                                    *detail::SchemaCodec<S>::max_content_size;
+
+    template<class S, typename = std::enable_if_t<detail::HasSchema<S>>>
+    std::size_t EncodedSize(const S &s) {
+        const auto content_sz = detail::SchemaCodec<S>::ContentSize(s);
+        return 1 + detail::LengthSize(content_sz) + content_sz;
+    }
+
+    template<class S, class OutputIt, typename = std::enable_if_t<detail::HasSchema<S> &&
+                                                                  detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(const S &s, OutputIt out) {
+        const auto content_sz = detail::SchemaCodec<S>::ContentSize(s);
+        Instrumentation::RecordEncoded(UniversalTagList::SEQUENCE, 1 + detail::LengthSize(content_sz) + content_sz);
+        out = std::copy(detail::sequence_identifier.begin(), detail::sequence_identifier.end(), out);
+        out = detail::WriteLength(content_sz, out);
+        return detail::SchemaCodec<S>::WriteContent(s, out);
+    }
+
+    template<class S, typename = std::enable_if_t<detail::HasSchema<S>>>
+    EncodedBerObject Encode(const S &s) {
+        EncodedBerObject result(EncodedSize(s));
+        EncodeTo(s, result.data());
+        return result;
+    }
+
+    /**
+     * Decode straight into the struct, fields are matched in schema order.
+     * Trailing unknown elements are ignored.
+     */
+    template<class S, typename = std::enable_if_t<detail::HasSchema<S>>>
+    void DecodeInto(OctetView encoded, S &s) {
+        Instrumentation::Guard([&] {
+            const TlvView tlv{encoded};
+            if (!tlv.IsUniversal(UniversalTagList::SEQUENCE) || !tlv.IsConstructed()) {
+                throw std::logic_error{"SEQUENCE is expected"};
+            }
+            detail::RecordDecodedTlv(tlv.Header(), tlv.Bytes().size());
+            detail::SchemaCodec<S>::ReadContent(tlv, s);
+        });
+    }
+
+    template<class S, typename = std::enable_if_t<detail::HasSchema<S>>>
+    S DecodeAs(OctetView encoded) {
+        S s{};
+        DecodeInto(encoded, s);
+        return s;
+    }
+}
+
+#endif //BER_SCHEMA_H
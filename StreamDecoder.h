@@ -0,0 +1,262 @@
+#ifndef BER_STREAMDECODER_H
+#define BER_STREAMDECODER_H
+
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <algorithm>
+#include <vector>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Instrumentation.h"
+#include "HeaderParser.h"
+
+namespace BER {
+    /**
+     * Push-style decoder for a stream of top-level TLVs arriving in arbitrary chunks.
+     * A TLV which starts and ends inside one chunk is handed out as a view into that chunk,
+     * only TLVs straddling a chunk boundary are accumulated in the internal buffer.
+     * Indefinite-length TLVs are delimited by scanning the headers of their nested TLVs,
+     * definite contents are skipped, so the scan does not depend on the chunking.
+     */
+    class StreamDecoder {
+        enum class State {
+            Identifier,
+            TagNumber,
+            Length,
+            LengthSubOctets,
+            Contents
+        };
+
+        State state_{State::Identifier};
+        TlvHeader header_;       // the top-level TLV
+        TlvHeader inner_;        // a TLV nested in an indefinite-length one
+        std::size_t depth_{};    // open indefinite-length encodings, 0 at the top level
+        std::size_t length_octets_left_{};
+        std::uintmax_t contents_left_{};
+        std::uintmax_t contents_size_{}; // contents of the top-level TLV seen so far
+        std::size_t max_length_;
+        std::pmr::vector<Octet> buffer_;
+
+        struct BufferGuard {
+            std::pmr::vector<Octet> &buffer;
+
+            ~BufferGuard() {
+                buffer.clear();
+            }
+        };
+
+        TlvHeader &Current() noexcept {
+            return depth_ == 0 ? header_ : inner_;
+        }
+
+        /**
+         * Account for size octets of the top-level TLV's contents, which shall not exceed max_length_.
+         */
+        void AddContents(std::uintmax_t size) {
+            if (size > max_length_ - contents_size_) {
+                Instrumentation::RecordError(Instrumentation::ErrorKind::SizeMismatch);
+                throw DecodeError{ErrorKind::SizeMismatch, "Length exceeds limit"};
+            }
+            contents_size_ += size;
+        }
+
+        void StartContents(std::uintmax_t length) {
+            AddContents(length);
+            contents_left_ = length;
+            state_ = State::Contents;
+        }
+
+        /**
+         * Identifier and length octets of the current TLV are complete. A TLV ends in State::Contents
+         * with no contents left, which is also where the end-of-contents octets of the outermost
+         * indefinite-length encoding lead.
+         */
+        void EndHeader() {
+            auto &header = Current();
+            if (depth_ > 0) {
+                AddContents(header.header_size);
+                if (header.identifier == 0) {
+                    if (header.header_size != 2 || header.length != 0) {
+                        throw std::logic_error{"Malformed end-of-contents"};
+                    }
+                    --depth_;
+                    StartContents(0);
+                    return;
+                }
+            }
+            if (!header.indefinite) {
+                StartContents(header.length);
+                return;
+            }
+            if (!header.identifier.IsConstructed()) {
+                throw std::logic_error{"Indefinite length for primitive encoding"};
+            }
+            ++depth_;
+            state_ = State::Identifier;
+        }
+
+    public:
+        struct Tlv {
+            TlvHeader header;
+            OctetView bytes; // identifier, length and contents octets
+
+            /**
+             * @return contents octets without end-of-contents octets
+             */
+            [[nodiscard]] OctetView Content() const noexcept {
+                const auto content = bytes.substr(header.header_size);
+                return header.indefinite ? content.substr(0, content.size() - 2) : content;
+            }
+        };
+
+        /**
+         * @param max_length upper bound for contents' length, larger TLVs are rejected before buffering;
+         *                   the contents of an indefinite-length TLV are checked as its nested TLVs arrive
+         * @param resource memory resource for the buffer of TLVs straddling chunks
+         */
+        explicit StreamDecoder(std::size_t max_length = std::numeric_limits<std::size_t>::max(),
+                               std::pmr::memory_resource *resource = std::pmr::get_default_resource()) :
+                max_length_(max_length), buffer_(resource) {}
+
+        /**
+         * Consume next chunk of the stream.
+         * @param handler invoked as handler(const Tlv&) for every TLV completed by this chunk,
+         *                Tlv::bytes is valid only during the call
+         * @return number of completed TLVs
+         */
+        template<class Handler>
+        std::size_t Feed(OctetView chunk, Handler &&handler) {
+            std::size_t emitted = 0;
+            std::size_t start = 0;
+            std::size_t pos = 0;
+
+            while (pos < chunk.size()) {
+                switch (state_) {
+                    case State::Identifier: {
+                        if (depth_ == 0) {
+                            start = pos;
+                            contents_size_ = 0;
+                        }
+                        auto &header = Current();
+                        // a header lying whole in the chunk is parsed at once, the states below handle
+                        // headers split between chunks and report errors
+                        if (TryParseHeader(chunk.substr(pos), header) == HeaderError::None) {
+                            pos += header.header_size;
+                            EndHeader();
+                            break;
+                        }
+                        const IdentifierOctet id{chunk[pos++]};
+                        header = TlvHeader{id, static_cast<std::uintmax_t>(id.TagNumber().value), 0, 1};
+                        if (id.IsLeadingOctet()) {
+                            header.tag_number = 0;
+                            state_ = State::TagNumber;
+                        } else {
+                            state_ = State::Length;
+                        }
+                        break;
+                    }
+                    case State::TagNumber: {
+                        auto &header = Current();
+                        const SubsequentIdOctet sub{chunk[pos++]};
+                        ++header.header_size;
+                        if (header.tag_number > (std::numeric_limits<std::uintmax_t>::max() >> 7)) {
+                            Instrumentation::RecordError(Instrumentation::ErrorKind::Overflow);
+                            throw DecodeError{ErrorKind::Overflow, "Integer overflow"};
+                        }
+                        header.tag_number = (header.tag_number << 7) | sub.Data().value;
+                        if (sub.IsEnd()) {
+                            state_ = State::Length;
+                        }
+                        break;
+                    }
+                    case State::Length: {
+                        auto &header = Current();
+                        header.identifier_size = static_cast<std::uint8_t>(header.header_size);
+                        const LengthOctet length{chunk[pos++]};
+                        ++header.header_size;
+                        if (length.IsShort()) {
+                            header.length = length.Data().value;
+                            EndHeader();
+                        } else if (length.IsInDefinite()) {
+                            header.indefinite = true;
+                            EndHeader();
+                        } else {
+                            length_octets_left_ = length.Data().value;
+                            if (length_octets_left_ > sizeof(std::uintmax_t)) {
+                                Instrumentation::RecordError(Instrumentation::ErrorKind::Overflow);
+                                throw DecodeError{ErrorKind::Overflow, "Integer overflow"};
+                            }
+                            state_ = State::LengthSubOctets;
+                        }
+                        break;
+                    }
+                    case State::LengthSubOctets: {
+                        auto &header = Current();
+                        header.length = (header.length << 8) | SubseqLengthOctet{chunk[pos++]}.Data().value;
+                        ++header.header_size;
+                        if (--length_octets_left_ == 0) {
+                            EndHeader();
+                        }
+                        break;
+                    }
+                    case State::Contents: {
+                        const auto take = static_cast<std::size_t>(
+                                std::min<std::uintmax_t>(contents_left_, chunk.size() - pos));
+                        pos += take;
+                        contents_left_ -= take;
+                        break;
+                    }
+                }
+
+                if (state_ == State::Contents && contents_left_ == 0) {
+                    state_ = State::Identifier;
+                    if (depth_ > 0) {
+                        continue;
+                    }
+                    ++emitted;
+                    detail::RecordDecodedTlv(header_, header_.header_size + static_cast<std::size_t>(contents_size_));
+                    if (buffer_.empty()) {
+                        handler(Tlv{header_, chunk.substr(start, pos - start)});
+                    } else {
+                        BufferGuard guard{buffer_};
+                        buffer_.insert(buffer_.end(), chunk.begin(), chunk.begin() + pos);
+                        handler(Tlv{header_, OctetView(buffer_.data(), buffer_.size())});
+                    }
+                }
+            }
+
+            if (!IsIdle()) {
+                if (state_ == State::Contents && depth_ == 0) {
+                    // the declared length is untrusted: grow with the octets that have arrived, geometrically
+                    // to keep copies linear, but never past the TLV's size
+                    const auto needed = buffer_.size() + (chunk.size() - start);
+                    if (needed > buffer_.capacity()) {
+                        buffer_.reserve(static_cast<std::size_t>(std::min<std::uintmax_t>(
+                                header_.header_size + header_.length, std::max(needed, 2 * buffer_.capacity()))));
+                    }
+                }
+                buffer_.insert(buffer_.end(), chunk.begin() + start, chunk.end());
+            }
+
+            return emitted;
+        }
+
+        /**
+         * @return true if the stream consumed so far ends on a TLV boundary
+         */
+        [[nodiscard]] bool IsIdle() const noexcept {
+            return state_ == State::Identifier && depth_ == 0;
+        }
+
+        void Reset() noexcept {
+            state_ = State::Identifier;
+            depth_ = 0;
+            buffer_.clear();
+        }
+    };
+}
+
+#endif //BER_STREAMDECODER_H
@@ -0,0 +1,140 @@
+#ifndef BER_STREAMENCODER_H
+#define BER_STREAMENCODER_H
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "EncodedBerObject.h"
+
+namespace BER {
+    /**
+     * Encoder emitting indefinite-length constructed encodings piece by piece.
+     * Octets are handed to sink(OctetView) as soon as they are produced, payload views are passed through
+     * without copying, so memory use does not depend on the size of the encoded value.
+     * @tparam Sink callable as sink(OctetView), the view is valid only during the call
+     */
+    template<class Sink>
+    class StreamEncoder {
+        static constexpr std::size_t small_value_size = 64;
+
+        Sink sink_;
+        std::size_t depth_{};
+
+        void Emit(OctetView view) {
+            if (!view.empty()) {
+                sink_(view);
+            }
+        }
+
+    public:
+        explicit StreamEncoder(Sink sink) : sink_(std::forward<Sink>(sink)) {}
+
+        /**
+         * Open an indefinite-length constructed encoding, closed by End().
+         */
+        StreamEncoder &Begin(IdentifierOctet::ClassTagType class_tag, IdentifierOctet::TagNumberType tag_number) {
+            const std::array<Octet, 2> header{
+                    IdentifierOctet{class_tag, IdentifierOctet::Constructed{true}, tag_number},
+                    LengthOctet{0x80}
+            };
+            Instrumentation::RecordEncodedLength(1, true);
+            Emit({header.data(), header.size()});
+            ++depth_;
+            return *this;
+        }
+
+        StreamEncoder &Begin(UniversalTagList::Type tag = UniversalTagList::SEQUENCE) {
+            return Begin(IdentifierOctet::Universal, IdentifierOctet::TagNumberType{tag});
+        }
+
+        /**
+         * Emit end-of-contents octets of the innermost open encoding.
+         */
+        StreamEncoder &End() {
+            if (depth_ == 0) {
+                throw std::logic_error{"No open constructed encoding"};
+            }
+            const std::array<Octet, 2> eoc{EOCOctet{}, EOCOctet{}};
+            Emit({eoc.data(), eoc.size()});
+            --depth_;
+            return *this;
+        }
+
+        /**
+         * Emit a primitive OCTET STRING, its contents are passed to the sink as is.
+         * Inside Begin(UniversalTagList::OCTET_STRING) it is a segment of the constructed string.
+         */
+        StreamEncoder &Add(OctetView str) {
+            std::array<Octet, 1 + sizeof(std::uintmax_t) + 1> header;
+            auto end = header.begin();
+            *end++ = IdentifierOctet{
+                    IdentifierOctet::Universal,
+                    IdentifierOctet::Constructed{false},
+                    IdentifierOctet::TagNumberType{UniversalTagList::OCTET_STRING}
+            };
+            end = detail::WriteLength(str.size(), end);
+            Instrumentation::RecordEncoded(UniversalTagList::OCTET_STRING,
+                                           static_cast<std::size_t>(end - header.begin()) + str.size());
+            Emit({header.data(), static_cast<std::size_t>(end - header.begin())});
+            Emit(str);
+            return *this;
+        }
+
+        template<class T>
+        StreamEncoder &Add(const T &value) {
+            const auto size = EncodedSize(value);
+            if (size <= small_value_size) {
+                std::array<Octet, small_value_size> buf;
+                EncodeTo(value, buf.data());
+                Emit({buf.data(), size});
+            } else {
+                std::vector<Octet> buf(size);
+                EncodeTo(value, buf.data());
+                Emit({buf.data(), size});
+            }
+            return *this;
+        }
+
+        /**
+         * Emit an already encoded TLV as is.
+         */
+        StreamEncoder &AddEncoded(OctetView tlv) {
+            Emit(tlv);
+            return *this;
+        }
+
+        [[nodiscard]] std::size_t Depth() const noexcept {
+            return depth_;
+        }
+    };
+
+    /**
+     * Encode an OCTET STRING of unknown size as an indefinite-length constructed encoding.
+     * @param producer callable as producer(std::span<Octet>) filling the buffer and returning the number of
+     *                 written octets, 0 marks the end of data
+     * @param chunk_size size of the only buffer, i.e. the maximal segment's size
+     */
+    template<class Producer, class Sink>
+    void EncodeOctetStringStream(Producer &&producer, Sink &&sink, std::size_t chunk_size = 64 * 1024) {
+        StreamEncoder<Sink &> encoder{sink};
+        std::vector<Octet> chunk(chunk_size);
+
+        encoder.Begin(UniversalTagList::OCTET_STRING);
+        for (std::size_t filled; (filled = producer(std::span<Octet>(chunk))) != 0;) {
+            if (filled > chunk.size()) {
+                throw std::logic_error{"Producer overflowed the chunk"};
+            }
+            encoder.Add(OctetView(chunk.data(), filled));
+        }
+        encoder.End();
+    }
+}
+
+#endif //BER_STREAMENCODER_H
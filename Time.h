@@ -0,0 +1,350 @@
+#ifndef BER_TIME_H
+#define BER_TIME_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "EncodedBerObject.h"
+#include "Instrumentation.h"
+#include "CharacterStrings.h"
+
+namespace BER {
+    /**
+     * UTCTime value, whole seconds in UTC. Two-digit years map to 1950..2049.
+     */
+    struct UtcTime {
+        std::chrono::sys_seconds value;
+
+        friend bool operator==(const UtcTime &, const UtcTime &) = default;
+    };
+
+    /**
+     * GeneralizedTime value in UTC. Fractions finer than a nanosecond are truncated on decoding.
+     */
+    struct GeneralizedTime {
+        std::chrono::sys_seconds seconds;
+        std::chrono::nanoseconds fraction{}; // [0, 1s)
+
+        template<class Duration>
+        static GeneralizedTime FromSysTime(std::chrono::sys_time<Duration> tp) {
+            const auto seconds = std::chrono::floor<std::chrono::seconds>(tp);
+            return {seconds, std::chrono::duration_cast<std::chrono::nanoseconds>(tp - seconds)};
+        }
+
+        template<class Duration = std::chrono::nanoseconds>
+        [[nodiscard]] std::chrono::sys_time<Duration> ToSysTime() const {
+            return std::chrono::time_point_cast<Duration>(seconds) + std::chrono::duration_cast<Duration>(fraction);
+        }
+
+        friend bool operator==(const GeneralizedTime &, const GeneralizedTime &) = default;
+    };
+
+    /**
+     * Longest contents produced by FormatTo(): YYYYMMDDHHMMSS.fffffffffZ
+     */
+    inline constexpr std::size_t max_generalized_time_size = 25;
+    inline constexpr std::size_t utc_time_size = 13;
+
+    namespace detail {
+        /**
+         * Octet i of the result has its high bit set if octet i of v is not an ASCII digit.
+         */
+        constexpr std::uint64_t NonDigitLanes(std::uint64_t v) noexcept {
+            const auto t = v ^ 0x3030303030303030ull;
+            return (((t & 0x7F7F7F7F7F7F7F7Full) + 0x7676767676767676ull) | t) & 0x8080808080808080ull;
+        }
+
+        /**
+         * Eight ASCII digits, the first one in the low octet, to four two-digit numbers in 16-bit lanes.
+         * Lanes past a non-digit are garbage.
+         */
+        constexpr std::uint64_t DigitPairs(std::uint64_t v) noexcept {
+            v -= 0x3030303030303030ull;
+            return (v * 10 + (v >> 8)) & 0x00FF00FF00FF00FFull;
+        }
+
+        /**
+         * Up to 16 leading digits of content as two-digit numbers.
+         * @return number of leading digits
+         */
+        inline std::size_t LeadingDigitPairs(OctetView content, std::array<int, 8> &pairs) noexcept {
+            Octet buf[16]{};
+            if (!content.empty()) {
+                std::memcpy(buf, content.data(), std::min<std::size_t>(content.size(), sizeof(buf)));
+            }
+            const std::uint64_t words[] = {LoadLittleEndian64(buf), LoadLittleEndian64(buf + 8)};
+
+            std::size_t digits = 0;
+            for (auto word : words) {
+                const auto bad = NonDigitLanes(word);
+                digits += bad != 0 ? std::countr_zero(bad) / 8 : 8;
+                if (bad != 0) {
+                    break;
+                }
+            }
+            for (std::size_t w = 0; w < 2; ++w) {
+                const auto p = DigitPairs(words[w]);
+                for (std::size_t i = 0; i < 4; ++i) {
+                    pairs[4 * w + i] = static_cast<int>((p >> (16 * i)) & 0xFF);
+                }
+            }
+            return digits;
+        }
+
+        constexpr bool IsDigit(Octet c) noexcept {
+            return c >= '0' && c <= '9';
+        }
+
+        inline int TwoDigits(const Octet *data) {
+            if (!IsDigit(data[0]) || !IsDigit(data[1])) {
+                throw std::logic_error{"Malformed time"};
+            }
+            return (data[0] - '0') * 10 + (data[1] - '0');
+        }
+
+        /**
+         * Trailing 'Z' or a +-hh[mm] offset at content[pos], the offset is returned in minutes.
+         */
+        inline int ParseTimeZone(OctetView content, std::size_t pos, bool minutes_required) {
+            if (pos == content.size()) {
+                throw DecodeError{ErrorKind::Unsupported, "Local time is not supported"};
+            }
+            const Octet sign = content[pos++];
+            if (sign == 'Z') {
+                if (pos != content.size()) {
+                    throw std::logic_error{"Malformed time"};
+                }
+                return 0;
+            }
+
+            const auto rest = content.size() - pos;
+            if ((sign != '+' && sign != '-') || (rest != 4 && (rest != 2 || minutes_required))) {
+                throw std::logic_error{"Malformed time"};
+            }
+            const int hours = TwoDigits(content.data() + pos);
+            const int minutes = rest == 4 ? TwoDigits(content.data() + pos + 2) : 0;
+            if (hours > 23 || minutes > 59) {
+                throw std::logic_error{"Malformed time"};
+            }
+            return (sign == '-' ? -1 : 1) * (hours * 60 + minutes);
+        }
+
+        inline std::chrono::sys_seconds ComposeTime(int year, int month, int day, int hour, int minute, int second,
+                                                    int offset_minutes) {
+            const std::chrono::year_month_day ymd{std::chrono::year{year},
+                                                  std::chrono::month{static_cast<unsigned>(month)},
+                                                  std::chrono::day{static_cast<unsigned>(day)}};
+            if (!ymd.ok() || hour > 23 || minute > 59 || second > 59) {
+                throw std::logic_error{"Malformed time"};
+            }
+            return std::chrono::sys_days{ymd} + std::chrono::hours{hour} +
+                   std::chrono::minutes{minute - offset_minutes} + std::chrono::seconds{second};
+        }
+
+        constexpr std::array<char, 200> MakeDigitPairsTable() {
+            std::array<char, 200> table{};
+            for (int i = 0; i < 100; ++i) {
+                table[2 * i] = static_cast<char>('0' + i / 10);
+                table[2 * i + 1] = static_cast<char>('0' + i % 10);
+            }
+            return table;
+        }
+
+        inline constexpr auto digit_pairs_table = MakeDigitPairsTable();
+
+        inline char *WritePair(unsigned v, char *out) noexcept {
+            std::memcpy(out, digit_pairs_table.data() + 2 * v, 2);
+            return out + 2;
+        }
+
+        /**
+         * YYMMDDHHMMSS (years 1950..2049) or YYYYMMDDHHMMSS (years 0..9999) of t.
+         */
+        inline char *WriteDateTime(std::chrono::sys_seconds t, bool four_digit_year, char *out) {
+            const auto days = std::chrono::floor<std::chrono::days>(t);
+            const std::chrono::year_month_day ymd{days};
+            const int year = static_cast<int>(ymd.year());
+            if (four_digit_year ? (year < 0 || year > 9999) : (year < 1950 || year > 2049)) {
+                throw std::logic_error{"Time is out of range"};
+            }
+            const std::chrono::hh_mm_ss tod{t - days};
+
+            if (four_digit_year) {
+                out = WritePair(year / 100, out);
+            }
+            out = WritePair(year % 100, out);
+            out = WritePair(static_cast<unsigned>(ymd.month()), out);
+            out = WritePair(static_cast<unsigned>(ymd.day()), out);
+            out = WritePair(tod.hours().count(), out);
+            out = WritePair(tod.minutes().count(), out);
+            return WritePair(tod.seconds().count(), out);
+        }
+
+        template<UniversalTagList::Type Tag, class OutputIt>
+        OutputIt EncodeTime(const char *content, std::size_t size, OutputIt out) {
+            Instrumentation::RecordEncoded(Tag, 2 + size);
+            *out++ = IdentifierOctet{
+                    IdentifierOctet::Universal,
+                    IdentifierOctet::Constructed{false},
+                    IdentifierOctet::TagNumberType{Tag}
+            };
+            out = WriteLength(size, out);
+            const auto octets = AsOctetView({content, size});
+            return std::copy(octets.begin(), octets.end(), out);
+        }
+    }
+
+    /**
+     * Parse UTCTime contents: YYMMDDhhmm[ss] followed by 'Z' or a +-hhmm offset.
+     * @throws std::logic_error on malformed contents
+     */
+    inline UtcTime ParseUtcTime(OctetView content) {
+        std::array<int, 8> p{};
+        const auto digits = detail::LeadingDigitPairs(content, p);
+        if (digits != 10 && digits != 12) {
+            throw std::logic_error{"Malformed time"};
+        }
+        const int offset = detail::ParseTimeZone(content, digits, true);
+        const int year = p[0] < 50 ? 2000 + p[0] : 1900 + p[0];
+        return {detail::ComposeTime(year, p[1], p[2], p[3], p[4], digits == 12 ? p[5] : 0, offset)};
+    }
+
+    /**
+     * Parse GeneralizedTime contents: YYYYMMDDhh[mm[ss]], an optional fraction of the last field
+     * after '.' or ',', then 'Z' or a +-hh[mm] offset. Local time without a zone cannot be mapped to UTC.
+     * @throws std::logic_error on malformed contents
+     */
+    inline GeneralizedTime ParseGeneralizedTime(OctetView content) {
+        std::array<int, 8> p{};
+        const auto digits = detail::LeadingDigitPairs(content, p);
+        if (digits != 10 && digits != 12 && digits != 14) {
+            throw std::logic_error{"Malformed time"};
+        }
+
+        std::size_t pos = digits;
+        std::int64_t fraction = 0; // billionths of the last field
+        if (pos < content.size() && (content[pos] == '.' || content[pos] == ',')) {
+            const auto first = ++pos;
+            for (; pos < content.size() && detail::IsDigit(content[pos]); ++pos) {
+                if (pos - first < 9) {
+                    fraction = fraction * 10 + (content[pos] - '0');
+                }
+            }
+            if (pos == first) {
+                throw std::logic_error{"Malformed time"};
+            }
+            for (auto n = pos - first; n < 9; ++n) {
+                fraction *= 10;
+            }
+        }
+        const int offset = detail::ParseTimeZone(content, pos, false);
+
+        static constexpr std::int64_t unit_seconds[] = {3600, 60, 1};
+        const auto fraction_ns = std::chrono::nanoseconds{fraction * unit_seconds[(digits - 10) / 2]};
+        const auto whole = std::chrono::floor<std::chrono::seconds>(fraction_ns);
+
+        const auto seconds = detail::ComposeTime(p[0] * 100 + p[1], p[2], p[3], p[4],
+                                                 digits >= 12 ? p[5] : 0, digits == 14 ? p[6] : 0, offset);
+        return {seconds + whole, fraction_ns - whole};
+    }
+
+    /**
+     * Write DER contents of t: YYMMDDHHMMSSZ.
+     * @param out room for utc_time_size characters
+     * @throws std::logic_error if the year is outside 1950..2049
+     */
+    inline char *FormatTo(const UtcTime &t, char *out) {
+        out = detail::WriteDateTime(t.value, false, out);
+        *out++ = 'Z';
+        return out;
+    }
+
+    /**
+     * Write DER contents of t: YYYYMMDDHHMMSS[.f]Z, the fraction has no trailing zeros.
+     * @param out room for max_generalized_time_size characters
+     * @throws std::logic_error if the year is outside 0..9999
+     */
+    inline char *FormatTo(const GeneralizedTime &t, char *out) {
+        const auto whole = std::chrono::floor<std::chrono::seconds>(t.fraction);
+        out = detail::WriteDateTime(t.seconds + whole, true, out);
+
+        auto ns = static_cast<std::uint32_t>((t.fraction - whole).count());
+        if (ns != 0) {
+            int digits = 9;
+            for (; ns % 10 == 0; ns /= 10) {
+                --digits;
+            }
+            *out++ = '.';
+            char buf[10];
+            for (int i = digits; i > 0; i -= 2) {
+                detail::WritePair(ns % 100, buf + i - 1);
+                ns /= 100;
+            }
+            std::memcpy(out, buf + 1, digits);
+            out += digits;
+        }
+        *out++ = 'Z';
+        return out;
+    }
+
+    inline std::size_t EncodedSize(const UtcTime &) noexcept {
+        return 2 + utc_time_size;
+    }
+
+    inline std::size_t EncodedSize(const GeneralizedTime &t) {
+        char buf[max_generalized_time_size];
+        return 2 + (FormatTo(t, buf) - buf);
+    }
+
+    template<class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(const UtcTime &t, OutputIt out) {
+        char buf[utc_time_size];
+        return detail::EncodeTime<UniversalTagList::UTCTime>(buf, FormatTo(t, buf) - buf, out);
+    }
+
+    template<class OutputIt, typename = std::enable_if_t<detail::IsOctetOutputIterator<OutputIt>>>
+    OutputIt EncodeTo(const GeneralizedTime &t, OutputIt out) {
+        char buf[max_generalized_time_size];
+        return detail::EncodeTime<UniversalTagList::GeneralizedTime>(buf, FormatTo(t, buf) - buf, out);
+    }
+
+    inline EncodedBerObject Encode(const UtcTime &t) {
+        EncodedBerObject result(EncodedSize(t));
+        EncodeTo(t, result.data());
+        return result;
+    }
+
+    inline EncodedBerObject Encode(const GeneralizedTime &t) {
+        char buf[max_generalized_time_size];
+        const auto size = static_cast<std::size_t>(FormatTo(t, buf) - buf);
+        EncodedBerObject result(2 + size);
+        detail::EncodeTime<UniversalTagList::GeneralizedTime>(buf, size, result.data());
+        return result;
+    }
+
+    /**
+     * Decode a primitive UTCTime TLV spanning the whole view.
+     */
+    inline UtcTime DecodeUtcTime(OctetView encoded) {
+        return ParseUtcTime(detail::BorrowedStringContent(encoded, UniversalTagList::UTCTime));
+    }
+
+    /**
+     * Decode a primitive GeneralizedTime TLV spanning the whole view.
+     */
+    inline GeneralizedTime DecodeGeneralizedTime(OctetView encoded) {
+        return ParseGeneralizedTime(detail::BorrowedStringContent(encoded, UniversalTagList::GeneralizedTime));
+    }
+}
+
+#endif //BER_TIME_H
@@ -0,0 +1,232 @@
+#ifndef BER_TLVVIEW_H
+#define BER_TLVVIEW_H
+
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Instrumentation.h"
+#include "HeaderParser.h"
+
+namespace BER {
+    class TlvIterator;
+
+    class TlvRange;
+
+    /**
+     * Nesting limit for segments of constructed strings, which are concatenated recursively.
+     */
+    inline constexpr std::size_t max_segment_depth = 64;
+
+    /**
+     * Nesting limit for indefinite-length encodings. Their size is found by scanning the nested TLVs,
+     * and a view of each nested one scans its subtree again, so deeper input would cost quadratic time.
+     */
+    inline constexpr std::size_t max_indefinite_depth = 256;
+
+    /**
+     * Non-owning view of a single TLV. Parses identifier and length octets only,
+     * contents are neither copied nor decoded.
+     */
+    class TlvView {
+        OctetView bytes_;
+        TlvHeader header_;
+
+        /**
+         * Size of indefinite-length contents up to (excluding) the matching end-of-contents octets.
+         * Nested TLVs are skipped iteratively, so the scan does not recurse.
+         * @throws DecodeError if indefinite-length encodings nest deeper than max_indefinite_depth
+         */
+        static std::size_t IndefiniteContentSize(OctetView content) {
+            std::size_t pos = 0;
+            std::size_t depth = 1;
+
+            for (;;) {
+                if (content.size() - pos >= 2 && content[pos] == 0 && content[pos + 1] == 0) {
+                    if (--depth == 0) {
+                        return pos;
+                    }
+                    pos += 2;
+                    continue;
+                }
+
+                const TlvHeader header = ParseHeader(content.substr(pos));
+                pos += header.header_size;
+                if (header.indefinite) {
+                    if (!header.identifier.IsConstructed()) {
+                        throw std::logic_error{"Indefinite length for primitive encoding"};
+                    }
+                    if (depth == max_indefinite_depth) {
+                        throw DecodeError{ErrorKind::Overflow, "Nesting is too deep"};
+                    }
+                    ++depth;
+                } else {
+                    if (content.size() - pos < header.length) {
+                        throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+                    }
+                    pos += header.length;
+                }
+            }
+        }
+
+    public:
+        TlvView() = default;
+
+        /**
+         * Parse the TLV at the beginning of view, trailing octets are ignored.
+         */
+        explicit TlvView(OctetView view) : header_(ParseHeader(view)) {
+            const OctetView rest = view.substr(header_.header_size);
+            std::size_t size;
+
+            if (header_.indefinite) {
+                if (!header_.identifier.IsConstructed()) {
+                    throw std::logic_error{"Indefinite length for primitive encoding"};
+                }
+                size = IndefiniteContentSize(rest) + 2;
+            } else {
+                if (rest.size() < header_.length) {
+                    throw DecodeError{ErrorKind::SizeMismatch, "Sizes' mismatch"};
+                }
+                size = static_cast<std::size_t>(header_.length);
+            }
+
+            bytes_ = view.substr(0, header_.header_size + size);
+        }
+
+        [[nodiscard]] const TlvHeader &Header() const noexcept {
+            return header_;
+        }
+
+        [[nodiscard]] IdentifierOctet::ClassTagType ClassTag() const noexcept {
+            return header_.identifier.ClassTag();
+        }
+
+        [[nodiscard]] std::uintmax_t TagNumber() const noexcept {
+            return header_.tag_number;
+        }
+
+        [[nodiscard]] bool IsConstructed() const noexcept {
+            return header_.identifier.IsConstructed();
+        }
+
+        [[nodiscard]] bool IsUniversal(UniversalTagList::Type tag) const noexcept {
+            return header_.identifier.ClassTag().value == IdentifierOctet::Universal.value && header_.tag_number == tag;
+        }
+
+        [[nodiscard]] bool IsInDefinite() const noexcept {
+            return header_.indefinite;
+        }
+
+        [[nodiscard]] std::size_t HeaderSize() const noexcept {
+            return header_.header_size;
+        }
+
+        /**
+         * @return identifier, length and contents octets (including end-of-contents octets if indefinite)
+         */
+        [[nodiscard]] OctetView Bytes() const noexcept {
+            return bytes_;
+        }
+
+        /**
+         * @return contents octets without end-of-contents octets
+         */
+        [[nodiscard]] OctetView Content() const noexcept {
+            const auto content = bytes_.substr(header_.header_size);
+            return header_.indefinite ? content.substr(0, content.size() - 2) : content;
+        }
+
+        [[nodiscard]] TlvRange Children() const;
+    };
+
+    /**
+     * Forward iterator over consecutive TLVs of an octet view.
+     */
+    class TlvIterator {
+        OctetView rest_;
+        TlvView current_;
+
+        void Load() {
+            if (!rest_.empty()) {
+                current_ = TlvView{rest_};
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = TlvView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const TlvView *;
+        using reference = const TlvView &;
+
+        TlvIterator() = default;
+
+        explicit TlvIterator(OctetView view) : rest_(view) {
+            Load();
+        }
+
+        reference operator*() const noexcept {
+            return current_;
+        }
+
+        pointer operator->() const noexcept {
+            return &current_;
+        }
+
+        TlvIterator &operator++() {
+            rest_.remove_prefix(current_.Bytes().size());
+            Load();
+            return *this;
+        }
+
+        TlvIterator operator++(int) {
+            auto tmp = *this;
+            ++*this;
+            return tmp;
+        }
+
+        /**
+         * @return octets not consumed yet, starting with the current TLV
+         */
+        [[nodiscard]] OctetView Rest() const noexcept {
+            return rest_;
+        }
+
+        friend bool operator==(const TlvIterator &lhs, const TlvIterator &rhs) noexcept {
+            return lhs.rest_.size() == rhs.rest_.size();
+        }
+
+        friend bool operator!=(const TlvIterator &lhs, const TlvIterator &rhs) noexcept {
+            return !(lhs == rhs);
+        }
+    };
+
+    class TlvRange {
+        OctetView view_;
+
+    public:
+        explicit TlvRange(OctetView view) : view_(view) {}
+
+        [[nodiscard]] TlvIterator begin() const {
+            return TlvIterator{view_};
+        }
+
+        [[nodiscard]] TlvIterator end() const noexcept {
+            return TlvIterator{};
+        }
+    };
+
+    inline TlvRange TlvView::Children() const {
+        if (!IsConstructed()) {
+            throw std::logic_error{"Primitive encoding has no children"};
+        }
+        return TlvRange{Content()};
+    }
+}
+
+#endif //BER_TLVVIEW_H
@@ -2,7 +2,10 @@
 #define BER_UTIL_H
 
 #include "Constants.h"
+#include <bit>
+#include <climits>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 
 namespace BER {
@@ -26,6 +29,74 @@ namespace BER {
             return ~value;
         }
     };
+
+    constexpr std::uint64_t ByteSwap(std::uint64_t v) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_bswap64(v);
+#else
+        v = ((v & 0x00FF00FF00FF00FFull) << 8) | ((v >> 8) & 0x00FF00FF00FF00FFull);
+        v = ((v & 0x0000FFFF0000FFFFull) << 16) | ((v >> 16) & 0x0000FFFF0000FFFFull);
+        return (v << 32) | (v >> 32);
+#endif
+    }
+
+    /**
+     * Reverse the order of bits within every octet of v.
+     */
+    constexpr std::uint64_t ReverseBitsInOctets(std::uint64_t v) noexcept {
+        v = ((v & 0x0F0F0F0F0F0F0F0Full) << 4) | ((v >> 4) & 0x0F0F0F0F0F0F0F0Full);
+        v = ((v & 0x3333333333333333ull) << 2) | ((v >> 2) & 0x3333333333333333ull);
+        return ((v & 0x5555555555555555ull) << 1) | ((v >> 1) & 0x5555555555555555ull);
+    }
+
+    /**
+     * Number of set bits; a SWAR reduction where the target has no popcount instruction,
+     * which is cheaper than the libgcc call std::popcount falls back to.
+     */
+    constexpr int PopCount64(std::uint64_t v) noexcept {
+#if defined(__x86_64__) && !defined(__POPCNT__)
+        v -= (v >> 1) & 0x5555555555555555ull;
+        v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+        v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+        return static_cast<int>((v * 0x0101010101010101ull) >> 56);
+#else
+        return std::popcount(v);
+#endif
+    }
+
+    /**
+     * Unaligned load of 8 octets as a big-endian number.
+     */
+    inline std::uint64_t LoadBigEndian64(const void *src) noexcept {
+        std::uint64_t v;
+        std::memcpy(&v, src, sizeof(v));
+        if constexpr(std::endian::native == std::endian::little) {
+            v = ByteSwap(v);
+        }
+        return v;
+    }
+
+    /**
+     * Unaligned load of 8 octets as a little-endian number, the first octet ends up in the low byte.
+     */
+    inline std::uint64_t LoadLittleEndian64(const void *src) noexcept {
+        std::uint64_t v;
+        std::memcpy(&v, src, sizeof(v));
+        if constexpr(std::endian::native == std::endian::big) {
+            v = ByteSwap(v);
+        }
+        return v;
+    }
+
+    /**
+     * Unaligned store of v as 8 big-endian octets.
+     */
+    inline void StoreBigEndian64(void *dst, std::uint64_t v) noexcept {
+        if constexpr(std::endian::native == std::endian::little) {
+            v = ByteSwap(v);
+        }
+        std::memcpy(dst, &v, sizeof(v));
+    }
 }
 
 #endif //BER_UTIL_H
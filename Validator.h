@@ -0,0 +1,352 @@
+#ifndef BER_VALIDATOR_H
+#define BER_VALIDATOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "Octet.h"
+#include "OctetClasses.h"
+#include "Constants.h"
+#include "HeaderParser.h"
+
+namespace BER {
+    enum class ValidationError {
+        None,
+        Empty,
+        TruncatedIdentifier,
+        TagOverflow,
+        NonMinimalTag,          // high-tag-number form for a tag below 31 or a leading 0x80 subsequent octet
+        TruncatedLength,
+        ReservedLength,         // long form with 127 subsequent octets (0xFF)
+        LengthOverflow,
+        LengthExceedsInput,     // contents run past the enclosing TLV or the buffer
+        IndefinitePrimitive,
+        UnexpectedEndOfContents,
+        MalformedEndOfContents,
+        MissingEndOfContents,
+        DepthExceeded,
+        TrailingOctets,
+        WrongEncodingForm,      // constructed where primitive is mandatory or vice versa
+        InvalidContents,        // BOOLEAN, INTEGER, NULL, OBJECT IDENTIFIER or BIT STRING contents
+        NonMinimalLength,       // DER
+        IndefiniteLength,       // DER
+        ConstructedString,      // DER
+        NonCanonicalBoolean,    // DER
+        NonZeroUnusedBits       // DER
+    };
+
+    struct ValidationOptions {
+        bool der = false;                 // also check DER canonical form (SET ordering is not checked)
+        bool allow_concatenated = false;  // accept a sequence of top-level TLVs
+        std::size_t max_depth = 64;       // at most max_validation_depth
+    };
+
+    struct ValidationResult {
+        ValidationError error{ValidationError::None};
+        std::size_t offset{};             // of the offending TLV or octet
+
+        explicit operator bool() const noexcept {
+            return error == ValidationError::None;
+        }
+    };
+
+    inline constexpr std::size_t max_validation_depth = 256;
+
+    namespace detail {
+        struct ValidationFrame {
+            std::size_t end;     // past the contents, meaningless if indefinite
+            std::size_t limit;   // no child may run past it
+            bool indefinite;
+        };
+
+        constexpr bool IsStringType(std::uintmax_t tag) noexcept {
+            switch (tag) {
+                case UniversalTagList::BIT_STRING:
+                case UniversalTagList::OCTET_STRING:
+                case UniversalTagList::ObjectDescriptor:
+                case UniversalTagList::UTF8String:
+                case UniversalTagList::NumericString:
+                case UniversalTagList::PrintableString:
+                case UniversalTagList::T61String:
+                case UniversalTagList::VideotexString:
+                case UniversalTagList::IA5String:
+                case UniversalTagList::UTCTime:
+                case UniversalTagList::GeneralizedTime:
+                case UniversalTagList::GraphicString:
+                case UniversalTagList::VisibleString:
+                case UniversalTagList::GeneralString:
+                case UniversalTagList::UniversalString:
+                case UniversalTagList::BMPString:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        constexpr bool IsAlwaysPrimitive(std::uintmax_t tag) noexcept {
+            switch (tag) {
+                case UniversalTagList::BOOLEAN:
+                case UniversalTagList::INTEGER:
+                case UniversalTagList::NULL_TYPE:
+                case UniversalTagList::OBJECT_IDENTIFIER:
+                case UniversalTagList::REAL:
+                case UniversalTagList::ENUMERATED:
+                case UniversalTagList::RELATIVE_OID:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        constexpr bool IsAlwaysConstructed(std::uintmax_t tag) noexcept {
+            return tag == UniversalTagList::SEQUENCE || tag == UniversalTagList::SET ||
+                   tag == UniversalTagList::EXTERNAL || tag == UniversalTagList::EMBEDDED_PDV ||
+                   tag == UniversalTagList::CHARACTER_STRING;
+        }
+
+        /**
+         * Contents' checks of primitive universal types whose decoders would reject or misread them.
+         */
+        constexpr ValidationError CheckPrimitiveContents(std::uintmax_t tag, OctetView content, bool der) noexcept {
+            switch (tag) {
+                case UniversalTagList::BOOLEAN:
+                    if (content.size() != 1) {
+                        return ValidationError::InvalidContents;
+                    }
+                    if (der && content[0] != 0x00 && content[0] != 0xFF) {
+                        return ValidationError::NonCanonicalBoolean;
+                    }
+                    return ValidationError::None;
+                case UniversalTagList::INTEGER:
+                case UniversalTagList::ENUMERATED:
+                    if (content.empty()) {
+                        return ValidationError::InvalidContents;
+                    }
+                    if (content.size() > 1 && ((content[0] == 0x00 && (content[1] & 0x80) == 0) ||
+                                               (content[0] == 0xFF && (content[1] & 0x80) != 0))) {
+                        return ValidationError::InvalidContents;
+                    }
+                    return ValidationError::None;
+                case UniversalTagList::NULL_TYPE:
+                    return content.empty() ? ValidationError::None : ValidationError::InvalidContents;
+                case UniversalTagList::OBJECT_IDENTIFIER:
+                case UniversalTagList::RELATIVE_OID: {
+                    if (content.empty() || (content.back() & 0x80) != 0) {
+                        return ValidationError::InvalidContents;
+                    }
+                    bool start = true;
+                    for (auto octet : content) {
+                        if (start && octet == 0x80) {
+                            return ValidationError::InvalidContents;
+                        }
+                        start = (octet & 0x80) == 0;
+                    }
+                    return ValidationError::None;
+                }
+                case UniversalTagList::BIT_STRING: {
+                    if (content.empty() || content[0] > 7 || (content.size() == 1 && content[0] != 0)) {
+                        return ValidationError::InvalidContents;
+                    }
+                    const auto unused_mask = (1u << static_cast<unsigned>(content[0])) - 1;
+                    if (der && content.size() > 1 && (content.back() & unused_mask) != 0) {
+                        return ValidationError::NonZeroUnusedBits;
+                    }
+                    return ValidationError::None;
+                }
+                default:
+                    return ValidationError::None;
+            }
+        }
+    }
+
+    /**
+     * Strict single-pass check of a buffer holding one TLV (or several with allow_concatenated):
+     * tag and length encodings, lengths of nested TLVs against their parents, nesting depth,
+     * pairing of end-of-contents octets and contents of the fixed-format universal types.
+     * Nothing is allocated and nothing is decoded, the first violation is reported.
+     */
+    constexpr ValidationResult Validate(OctetView input, const ValidationOptions &options = {}) noexcept {
+        const auto fail = [](ValidationError error, std::size_t offset) {
+            return ValidationResult{error, offset};
+        };
+
+        if (input.empty()) {
+            return fail(ValidationError::Empty, 0);
+        }
+
+        const std::size_t max_depth = options.max_depth < max_validation_depth
+                                      ? options.max_depth : max_validation_depth;
+        std::array<detail::ValidationFrame, max_validation_depth> stack{};
+        std::size_t depth = 0;
+        std::size_t pos = 0;
+
+        for (;;) {
+            if (depth > 0 && !stack[depth - 1].indefinite && pos == stack[depth - 1].end) {
+                --depth;
+                continue;
+            }
+            if (depth == 0 && pos > 0) {
+                if (pos == input.size()) {
+                    return {};
+                }
+                if (!options.allow_concatenated) {
+                    return fail(ValidationError::TrailingOctets, pos);
+                }
+            }
+
+            const std::size_t limit = depth > 0 ? stack[depth - 1].limit : input.size();
+            const std::size_t start = pos;
+            if (pos == limit) {
+                return fail(depth > 0 && stack[depth - 1].indefinite ? ValidationError::MissingEndOfContents
+                                                                     : ValidationError::LengthExceedsInput, pos);
+            }
+
+            if (input[start] == 0x00) {
+                if (pos + 1 == limit || input[pos + 1] != 0x00) {
+                    return fail(ValidationError::MalformedEndOfContents, start);
+                }
+                if (depth == 0 || !stack[depth - 1].indefinite) {
+                    return fail(ValidationError::UnexpectedEndOfContents, start);
+                }
+                pos += 2;
+                --depth;
+                continue;
+            }
+
+            TlvHeader header;
+            const auto header_error = TryParseHeader(input.substr(start, limit - start), header);
+            if (header_error == HeaderError::TruncatedIdentifier) {
+                return fail(ValidationError::TruncatedIdentifier, start);
+            }
+            if (header_error == HeaderError::TagOverflow) {
+                return fail(input[start + 1] == 0x80 ? ValidationError::NonMinimalTag
+                                                     : ValidationError::TagOverflow, start);
+            }
+            // the high-tag-number form is for tags from 31 on, without leading zero groups
+            if (header.identifier_size > 1 && (header.tag_number < 31 || input[start + 1] == 0x80)) {
+                return fail(ValidationError::NonMinimalTag, start);
+            }
+            switch (header_error) {
+                case HeaderError::None:
+                    break;
+                case HeaderError::LengthOverflow:
+                    return fail(ValidationError::LengthOverflow, start);
+                case HeaderError::ReservedLength:
+                    return fail(ValidationError::ReservedLength, start);
+                default:
+                    return fail(ValidationError::TruncatedLength, start);
+            }
+
+            const std::uintmax_t tag = header.tag_number;
+            const bool constructed = header.identifier.IsConstructed();
+            const bool indefinite = header.indefinite;
+            const std::uintmax_t length = header.length;
+            const std::size_t length_pos = start + header.identifier_size;
+            pos = start + header.header_size;
+
+            if (indefinite && !constructed) {
+                return fail(ValidationError::IndefinitePrimitive, start);
+            }
+            if (indefinite && options.der) {
+                return fail(ValidationError::IndefiniteLength, start);
+            }
+            if (options.der && pos - length_pos > 1 && (input[length_pos + 1] == 0 || length < 128)) {
+                return fail(ValidationError::NonMinimalLength, start);
+            }
+
+            if (!indefinite && length > limit - pos) {
+                return fail(ValidationError::LengthExceedsInput, start);
+            }
+
+            const bool universal = header.identifier.ClassTag().value == IdentifierOctet::Universal.value;
+            if (universal) {
+                if ((constructed && detail::IsAlwaysPrimitive(tag)) ||
+                    (!constructed && detail::IsAlwaysConstructed(tag))) {
+                    return fail(ValidationError::WrongEncodingForm, start);
+                }
+                if (options.der && constructed && detail::IsStringType(tag)) {
+                    return fail(ValidationError::ConstructedString, start);
+                }
+            }
+
+            if (!constructed) {
+                if (universal) {
+                    const auto error = detail::CheckPrimitiveContents(
+                            tag, input.substr(pos, static_cast<std::size_t>(length)), options.der);
+                    if (error != ValidationError::None) {
+                        return fail(error, start);
+                    }
+                }
+                pos += static_cast<std::size_t>(length);
+                continue;
+            }
+
+            if (depth == max_depth) {
+                return fail(ValidationError::DepthExceeded, start);
+            }
+            if (indefinite) {
+                stack[depth++] = {0, limit, true};
+            } else {
+                const auto end = pos + static_cast<std::size_t>(length);
+                stack[depth++] = {end, end, false};
+            }
+        }
+    }
+
+    /**
+     * Short description of a validation error.
+     */
+    constexpr const char *ValidationMessage(ValidationError error) noexcept {
+        switch (error) {
+            case ValidationError::None:
+                return "Valid";
+            case ValidationError::Empty:
+                return "Empty octet stream";
+            case ValidationError::TruncatedIdentifier:
+                return "Truncated identifier";
+            case ValidationError::TagOverflow:
+                return "Tag number overflow";
+            case ValidationError::NonMinimalTag:
+                return "Non-minimal tag number";
+            case ValidationError::TruncatedLength:
+                return "Truncated length";
+            case ValidationError::ReservedLength:
+                return "Reserved length octet";
+            case ValidationError::LengthOverflow:
+                return "Length overflow";
+            case ValidationError::LengthExceedsInput:
+                return "Length exceeds enclosing encoding";
+            case ValidationError::IndefinitePrimitive:
+                return "Indefinite length for primitive encoding";
+            case ValidationError::UnexpectedEndOfContents:
+                return "Unexpected end-of-contents";
+            case ValidationError::MalformedEndOfContents:
+                return "Malformed end-of-contents";
+            case ValidationError::MissingEndOfContents:
+                return "Missing end-of-contents";
+            case ValidationError::DepthExceeded:
+                return "Nesting is too deep";
+            case ValidationError::TrailingOctets:
+                return "Trailing octets";
+            case ValidationError::WrongEncodingForm:
+                return "Wrong primitive/constructed form";
+            case ValidationError::InvalidContents:
+                return "Invalid contents";
+            case ValidationError::NonMinimalLength:
+                return "Non-minimal length (DER)";
+            case ValidationError::IndefiniteLength:
+                return "Indefinite length (DER)";
+            case ValidationError::ConstructedString:
+                return "Constructed string (DER)";
+            case ValidationError::NonCanonicalBoolean:
+                return "Non-canonical BOOLEAN (DER)";
+            case ValidationError::NonZeroUnusedBits:
+                return "Non-zero unused bits (DER)";
+        }
+        return "Unknown error";
+    }
+}
+
+#endif //BER_VALIDATOR_H
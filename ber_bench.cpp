@@ -0,0 +1,541 @@
+// Encode/decode micro-benchmarks.
+//
+//     ber_bench [--filter=SUBSTR] [--min-time=MS] [--format=table|csv|json] [--out=FILE]
+//
+// Every case reports ns/op, bytes/s of encoded data and heap allocations per op
+// (counted by replacing the global operator new). Cases whose results can be checked
+// check them once before timing, a failed check ends the run with exit code 1.
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <numbers>
+#include <stdexcept>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Octet.h"
+#include "EncodedBerObject.h"
+#include "DecodedBerObject.h"
+#include "DecodedDocument.h"
+#include "BerBuilder.h"
+#include "TlvView.h"
+#include "CharacterStrings.h"
+#include "BitString.h"
+#include "BigInteger.h"
+#include "Time.h"
+#include "GatherEncoder.h"
+#include "StreamEncoder.h"
+#include "StreamDecoder.h"
+
+namespace {
+    std::atomic<std::size_t> allocations{0};
+    std::atomic<std::size_t> allocated_bytes{0};
+
+    void *CountedAlloc(std::size_t size) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+        if (void *p = std::malloc(size == 0 ? 1 : size)) {
+            return p;
+        }
+        throw std::bad_alloc{};
+    }
+
+    void *CountedAlignedAlloc(std::size_t size, std::align_val_t align) {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+        const auto alignment = static_cast<std::size_t>(align);
+        if (void *p = std::aligned_alloc(alignment, (std::max<std::size_t>(size, 1) + alignment - 1) / alignment * alignment)) {
+            return p;
+        }
+        throw std::bad_alloc{};
+    }
+}
+
+void *operator new(std::size_t size) { return CountedAlloc(size); }
+
+void *operator new[](std::size_t size) { return CountedAlloc(size); }
+
+void *operator new(std::size_t size, std::align_val_t align) { return CountedAlignedAlloc(size, align); }
+
+void *operator new[](std::size_t size, std::align_val_t align) { return CountedAlignedAlloc(size, align); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+using namespace BER;
+
+namespace {
+    template<class T>
+    void DoNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        static volatile const void *sink;
+        sink = &value;
+#endif
+    }
+
+    struct Result {
+        std::string name;
+        std::size_t iterations;
+        double ns_per_op;
+        double bytes_per_sec;
+        double allocs_per_op;
+        double alloc_bytes_per_op;
+    };
+
+    struct Options {
+        std::string filter;
+        std::chrono::nanoseconds min_time = std::chrono::milliseconds{200};
+        std::string format = "table";
+        std::string out;
+    };
+
+    class Runner {
+        const Options &options_;
+        std::vector<Result> results_;
+
+    public:
+        explicit Runner(const Options &options) : options_(options) {}
+
+        /**
+         * Time op in batches, doubling the batch until it runs for at least min_time.
+         * @param bytes encoded size processed by one op
+         */
+        void Run(const std::string &name, std::size_t bytes, const std::function<void()> &op) {
+            if (name.find(options_.filter) == std::string::npos) {
+                return;
+            }
+
+            op(); // warm-up, also fills lazily initialized state
+            using Clock = std::chrono::steady_clock;
+
+            for (std::size_t iterations = 1;; iterations *= 2) {
+                const auto allocs_before = allocations.load(std::memory_order_relaxed);
+                const auto bytes_before = allocated_bytes.load(std::memory_order_relaxed);
+                const auto start = Clock::now();
+                for (std::size_t i = 0; i < iterations; ++i) {
+                    op();
+                }
+                const auto elapsed = Clock::now() - start;
+
+                if (elapsed >= options_.min_time || iterations >= (std::size_t{1} << 40)) {
+                    const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+                    const double n = static_cast<double>(iterations);
+                    results_.push_back({
+                            name, iterations, ns / n,
+                            ns > 0 ? static_cast<double>(bytes) * n * 1e9 / ns : 0,
+                            static_cast<double>(allocations.load(std::memory_order_relaxed) - allocs_before) / n,
+                            static_cast<double>(allocated_bytes.load(std::memory_order_relaxed) - bytes_before) / n
+                    });
+                    return;
+                }
+            }
+        }
+
+        void Write(std::ostream &os) const {
+            char line[256];
+            if (options_.format == "csv") {
+                os << "name,iterations,ns_per_op,bytes_per_sec,allocs_per_op,alloc_bytes_per_op\n";
+                for (auto &&r : results_) {
+                    std::snprintf(line, sizeof(line), "%s,%zu,%.3f,%.0f,%.3f,%.1f\n", r.name.c_str(), r.iterations,
+                                  r.ns_per_op, r.bytes_per_sec, r.allocs_per_op, r.alloc_bytes_per_op);
+                    os << line;
+                }
+            } else if (options_.format == "json") {
+                os << "{\"benchmarks\":[";
+                for (std::size_t i = 0; i < results_.size(); ++i) {
+                    const auto &r = results_[i];
+                    std::snprintf(line, sizeof(line),
+                                  "%s\n{\"name\":\"%s\",\"iterations\":%zu,\"ns_per_op\":%.3f,\"bytes_per_sec\":%.0f,"
+                                  "\"allocs_per_op\":%.3f,\"alloc_bytes_per_op\":%.1f}",
+                                  i == 0 ? "" : ",", r.name.c_str(), r.iterations, r.ns_per_op, r.bytes_per_sec,
+                                  r.allocs_per_op, r.alloc_bytes_per_op);
+                    os << line;
+                }
+                os << "\n]}\n";
+            } else {
+                std::snprintf(line, sizeof(line), "%-40s %14s %14s %12s %12s\n",
+                              "benchmark", "ns/op", "MB/s", "allocs/op", "B alloc/op");
+                os << line;
+                for (auto &&r : results_) {
+                    std::snprintf(line, sizeof(line), "%-40s %14.2f %14.1f %12.2f %12.1f\n", r.name.c_str(),
+                                  r.ns_per_op, r.bytes_per_sec / 1e6, r.allocs_per_op, r.alloc_bytes_per_op);
+                    os << line;
+                }
+            }
+        }
+    };
+
+    template<class T>
+    void EncodeDecode(Runner &runner, const std::string &name, const T &value) {
+        const auto encoded = Encode(value);
+        runner.Run("encode/" + name, encoded.size(), [&] {
+            DoNotOptimize(Encode(value));
+        });
+        runner.Run("encode_to/" + name, encoded.size(), [&] {
+            Octet buffer[64];
+            DoNotOptimize(EncodeTo(value, buffer));
+        });
+        runner.Run("decode/" + name, encoded.size(), [&] {
+            DoNotOptimize(Decode(encoded));
+        });
+    }
+
+    void OctetStrings(Runner &runner) {
+        for (std::size_t size : {std::size_t{0}, std::size_t{16}, std::size_t{256}, std::size_t{4} << 10,
+                                 std::size_t{64} << 10, std::size_t{1} << 20, std::size_t{16} << 20}) {
+            const OctetString payload(size, Octet{'x'});
+            const auto encoded = Encode(OctetView{payload});
+            const auto name = "OCTET_STRING/" + std::to_string(size);
+
+            runner.Run("encode/" + name, encoded.size(), [&] {
+                DoNotOptimize(Encode(OctetView{payload}));
+            });
+            GatherEncoder gather;
+            runner.Run("encode_gather/" + name, encoded.size(), [&] {
+                gather.Add(OctetView{payload});
+                DoNotOptimize(gather.Release());
+            });
+            runner.Run("decode/" + name, encoded.size(), [&] {
+                DoNotOptimize(Decode(encoded));
+            });
+            runner.Run("view/" + name, encoded.size(), [&] {
+                DoNotOptimize(TlvView{OctetView{encoded.data(), encoded.size()}}.Content());
+            });
+        }
+    }
+
+    void CharacterStrings(Runner &runner) {
+        const std::string printable(1024, 'A');
+        const std::string utf8 = [] {
+            std::string result;
+            while (result.size() < 1024) {
+                result += "text \xD1\x82\xD0\xB5\xD0\xBA\xD1\x81\xD1\x82 ";
+            }
+            return result;
+        }();
+
+        EncodeDecode(runner, "PrintableString/short", PrintableString{"Main St. 12"});
+        EncodeDecode(runner, "UTF8String/short", Utf8String{"caf\xC3\xA9"});
+
+        const auto long_printable = Encode(PrintableString{printable});
+        runner.Run("encode/PrintableString/1024", long_printable.size(), [&] {
+            DoNotOptimize(Encode(PrintableString{printable}));
+        });
+        runner.Run("view/PrintableString/1024", long_printable.size(), [&] {
+            DoNotOptimize(DecodeStringView<PrintableString>({long_printable.data(), long_printable.size()}));
+        });
+
+        const auto long_utf8 = Encode(Utf8String{utf8});
+        runner.Run("view/UTF8String/" + std::to_string(utf8.size()), long_utf8.size(), [&] {
+            DoNotOptimize(DecodeStringView<Utf8String>({long_utf8.data(), long_utf8.size()}));
+        });
+    }
+
+    void BitStrings(Runner &runner) {
+        for (std::size_t bits : {std::size_t{64}, std::size_t{8} << 20}) {
+            std::vector<std::uint64_t> words(bits / 64);
+            for (std::size_t i = 0; i < words.size(); ++i) {
+                words[i] = 0x9E3779B97F4A7C15ull * (i + 1);
+            }
+            const BitStringWords<std::uint64_t> value{words, bits};
+            const auto encoded = Encode(value);
+            const OctetView view{encoded.data(), encoded.size()};
+            const auto name = "BIT_STRING/" + std::to_string(bits);
+
+            runner.Run("encode/" + name, encoded.size(), [&] {
+                DoNotOptimize(Encode(value));
+            });
+            runner.Run("view_count/" + name, encoded.size(), [&] {
+                DoNotOptimize(DecodeBitStringView(view).Count());
+            });
+            runner.Run("decode/" + name, encoded.size(), [&] {
+                DoNotOptimize(Decode(encoded));
+            });
+        }
+    }
+
+    void BigIntegers(Runner &runner) {
+        for (std::size_t bits : {std::size_t{128}, std::size_t{4096}}) {
+            std::vector<std::uint64_t> limbs(bits / 64);
+            for (std::size_t i = 0; i < limbs.size(); ++i) {
+                limbs[i] = 0x9E3779B97F4A7C15ull * (i + 1);
+            }
+            limbs.back() |= 0x8000000000000000ull; // a modulus, the sign octet is needed
+            const auto name = "INTEGER/big/" + std::to_string(bits);
+
+            for (bool negative : {false, true}) {
+                const BigIntegerLimbs<std::uint64_t> value{limbs, negative};
+                const auto encoded = Encode(value);
+                const OctetView view{encoded.data(), encoded.size()};
+                const auto suffix = negative ? "/neg" : "/pos";
+
+                runner.Run("encode/" + name + suffix, encoded.size(), [&] {
+                    DoNotOptimize(Encode(value));
+                });
+                runner.Run("to_limbs/" + name + suffix, encoded.size(), [&] {
+                    std::array<std::uint64_t, 4096 / 64 + 1> out;
+                    DoNotOptimize(DecodeBigIntegerView(view).ToLimbs(std::span<std::uint64_t>{out}));
+                });
+            }
+        }
+    }
+
+    void Times(Runner &runner) {
+        const GeneralizedTime value{std::chrono::sys_days{std::chrono::year{2024} / 2 / 29} + std::chrono::hours{13},
+                                    std::chrono::milliseconds{250}};
+        const auto encoded = Encode(value);
+        const OctetView view{encoded.data(), encoded.size()};
+
+        runner.Run("encode/GeneralizedTime", encoded.size(), [&] {
+            std::array<Octet, 2 + max_generalized_time_size> buf;
+            DoNotOptimize(EncodeTo(value, buf.data()));
+        });
+        runner.Run("view/GeneralizedTime", encoded.size(), [&] {
+            DoNotOptimize(DecodeGeneralizedTime(view));
+        });
+        runner.Run("decode/GeneralizedTime", encoded.size(), [&] {
+            DoNotOptimize(Decode(encoded));
+        });
+
+        const auto utc = Encode(UtcTime{value.seconds});
+        const OctetView utc_view{utc.data(), utc.size()};
+        runner.Run("view/UTCTime", utc.size(), [&] {
+            DoNotOptimize(DecodeUtcTime(utc_view));
+        });
+    }
+
+    /**
+     * A CDR-like message: SEQUENCE { INTEGER, REAL, OCTET STRING, SEQUENCE OF SEQUENCE { INTEGER, BOOLEAN } }.
+     */
+    void BuildMessage(BerBuilder &builder, std::size_t items) {
+        static const OctetString caller(24, Octet{'7'});
+        builder.Begin();
+        builder.Add(std::int64_t{1234567890123});
+        builder.Add(3.25);
+        builder.Add(OctetView{caller});
+        builder.Begin();
+        for (std::size_t i = 0; i < items; ++i) {
+            builder.Begin();
+            builder.Add(static_cast<int>(i * 1000));
+            builder.Add(i % 2 == 0);
+            builder.End();
+        }
+        builder.End();
+        builder.End();
+    }
+
+    std::size_t CountNodes(const DecodedNode &node) {
+        std::size_t count = 1;
+        for (auto &&child : node.Children()) {
+            count += CountNodes(child);
+        }
+        return count;
+    }
+
+    void Nested(Runner &runner) {
+        for (std::size_t items : {std::size_t{4}, std::size_t{64}, std::size_t{1024}}) {
+            BerBuilder reference;
+            BuildMessage(reference, items);
+            const auto encoded = reference.Release();
+            const OctetView view{encoded.data(), encoded.size()};
+            const auto name = "nested/" + std::to_string(items);
+
+            runner.Run("encode/" + name, encoded.size(), [&] {
+                BerBuilder builder;
+                BuildMessage(builder, items);
+                DoNotOptimize(builder.Release());
+            });
+
+            BerBuilder reused;
+            runner.Run("encode_reuse/" + name, encoded.size(), [&] {
+                reused.Clear();
+                BuildMessage(reused, items);
+                DoNotOptimize(reused.View());
+            });
+
+            DocumentArena arena;
+            runner.Run("decode_document/" + name, encoded.size(), [&] {
+                arena.Release();
+                const DecodedDocument document{view, arena.Resource(), true};
+                DoNotOptimize(CountNodes(document.Root()));
+            });
+        }
+    }
+
+    /**
+     * Feed encoded to a StreamDecoder in chunks of chunk_size octets.
+     * @return copies of the emitted TLVs
+     */
+    std::vector<OctetString> FeedInChunks(OctetView encoded, std::size_t chunk_size) {
+        StreamDecoder decoder;
+        std::vector<OctetString> result;
+        for (std::size_t pos = 0; pos < encoded.size(); pos += chunk_size) {
+            decoder.Feed(encoded.substr(pos, chunk_size), [&](const StreamDecoder::Tlv &tlv) {
+                result.emplace_back(tlv.bytes);
+            });
+        }
+        if (!decoder.IsIdle()) {
+            throw std::logic_error{"StreamDecoder: stream ends inside a TLV"};
+        }
+        return result;
+    }
+
+    /**
+     * StreamEncoder output followed by a definite-length TLV, both shall come out of a StreamDecoder
+     * unchanged however the stream is chunked.
+     */
+    void Streams(Runner &runner) {
+        OctetString string_stream;
+        const auto append = [](OctetString &out) {
+            return [&out](OctetView view) { out.append(view); };
+        };
+        std::size_t produced = 0;
+        EncodeOctetStringStream([&](std::span<Octet> chunk) {
+            const auto size = std::min<std::size_t>(chunk.size(), 2500 - produced);
+            std::fill_n(chunk.begin(), size, Octet{'x'});
+            produced += size;
+            return size;
+        }, append(string_stream), 1000);
+
+        OctetString message;
+        StreamEncoder encoder{append(message)};
+        encoder.Begin();
+        encoder.Add(std::int64_t{1234567890123});
+        encoder.Begin(UniversalTagList::SET);
+        encoder.Add(OctetView{string_stream}.substr(0, 200));
+        encoder.Begin(IdentifierOctet::ContextSpecific, IdentifierOctet::TagNumberType{3});
+        encoder.End();
+        encoder.End();
+        BerBuilder definite;
+        BuildMessage(definite, 4);
+        encoder.AddEncoded(definite.View());
+        encoder.End();
+
+        for (auto &&[name, first] : {std::pair{std::string{"octet_string_stream"}, OctetView{string_stream}},
+                                     std::pair{std::string{"nested"}, OctetView{message}}}) {
+            const auto trailer = Encode(std::int32_t{42});
+            OctetString encoded{first};
+            encoded.append(trailer.begin(), trailer.end());
+
+            for (std::size_t chunk_size : {std::size_t{1}, std::size_t{2}, std::size_t{3}, std::size_t{7},
+                                           std::size_t{64}, encoded.size()}) {
+                const auto tlvs = FeedInChunks(encoded, chunk_size);
+                if (tlvs.size() != 2 || tlvs[0] != first || tlvs[1] != OctetView(trailer.data(), trailer.size())) {
+                    throw std::logic_error{"StreamDecoder: " + name + " does not round-trip in chunks of " +
+                                           std::to_string(chunk_size)};
+                }
+            }
+
+            for (std::size_t chunk_size : {std::size_t{64}, std::size_t{4096}}) {
+                runner.Run("stream/" + name + "/" + std::to_string(chunk_size), encoded.size(), [&] {
+                    StreamDecoder decoder;
+                    std::size_t count = 0;
+                    for (std::size_t pos = 0; pos < encoded.size(); pos += chunk_size) {
+                        count += decoder.Feed(OctetView{encoded}.substr(pos, chunk_size),
+                                              [](const StreamDecoder::Tlv &tlv) { DoNotOptimize(tlv.bytes); });
+                    }
+                    DoNotOptimize(count);
+                });
+            }
+        }
+    }
+
+    bool ParseOptions(int argc, char **argv, Options &options) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg{argv[i]};
+            const auto value = arg.substr(std::min(arg.find('=') + 1, arg.size()));
+            if (arg.starts_with("--filter=")) {
+                options.filter = value;
+            } else if (arg.starts_with("--min-time=")) {
+                options.min_time = std::chrono::milliseconds{std::atoll(std::string{value}.c_str())};
+            } else if (arg.starts_with("--format=") && (value == "table" || value == "csv" || value == "json")) {
+                options.format = value;
+            } else if (arg.starts_with("--out=")) {
+                options.out = value;
+            } else {
+                std::cerr << "usage: " << argv[0]
+                          << " [--filter=SUBSTR] [--min-time=MS] [--format=table|csv|json] [--out=FILE]\n";
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    Runner runner{options};
+    try {
+        EncodeDecode(runner, "BOOLEAN", true);
+
+        EncodeDecode(runner, "INTEGER/int8/pos", std::int8_t{100});
+        EncodeDecode(runner, "INTEGER/int8/neg", std::int8_t{-100});
+        EncodeDecode(runner, "INTEGER/int16/pos", std::int16_t{30000});
+        EncodeDecode(runner, "INTEGER/int16/neg", std::int16_t{-30000});
+        EncodeDecode(runner, "INTEGER/int32/pos", std::int32_t{2000000000});
+        EncodeDecode(runner, "INTEGER/int32/neg", std::int32_t{-2000000000});
+        EncodeDecode(runner, "INTEGER/int64/pos", std::numeric_limits<std::int64_t>::max());
+        EncodeDecode(runner, "INTEGER/int64/neg", std::numeric_limits<std::int64_t>::min());
+        EncodeDecode(runner, "INTEGER/uint32", std::uint32_t{4000000000});
+
+        EncodeDecode(runner, "REAL/zero", 0.0);
+        EncodeDecode(runner, "REAL/small_int", 3.0);
+        EncodeDecode(runner, "REAL/pi", std::numbers::pi);
+        EncodeDecode(runner, "REAL/huge_neg", -1.5e300);
+        EncodeDecode(runner, "REAL/float", 0.1f);
+
+        OctetStrings(runner);
+        CharacterStrings(runner);
+        BitStrings(runner);
+        BigIntegers(runner);
+        Times(runner);
+        Nested(runner);
+        Streams(runner);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+
+    if (options.out.empty()) {
+        runner.Write(std::cout);
+    } else {
+        std::ofstream file{options.out};
+        runner.Write(file);
+        if (!file) {
+            std::cerr << "cannot write " << options.out << '\n';
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -1,42 +1,532 @@
+// BER dump tool: prints the TLV tree of every top-level record of a file or of stdin.
+//
+//     BER [--skip=N] [--count=N] [--depth=N] [--limit=N] [FILE|-]
+//
+// Every line holds the absolute offset, the tag, the length and, for primitive encodings,
+// the value of known universal types or the contents in hex. Files, stdin redirected from a file included,
+// are memory mapped, so records skipped with --skip cost a header parse each. A pipe is streamed,
+// which takes definite-length top-level records.
+
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "Octet.h"
-#include "EncodedBerObject.h"
-#include "DecodedBerObject.h"
+#include "OctetClasses.h"
 #include "Constants.h"
-#include <sstream>
-#include <iomanip>
+#include "TlvView.h"
+#include "DecodedBerObject.h"
+#include "ObjectIdentifier.h"
+#include "StreamDecoder.h"
+#include "BerFile.h"
+#include "Time.h"
 
 using namespace BER;
 
-std::ostream &operator<<(std::ostream &os, const EncodedBerObject &str) {
-    for (int i = 0; i < 2; ++i) {
-        os << std::hex << std::setw(2) << std::setfill('0') << (unsigned short) str[i] << ' ';
+namespace {
+    struct Options {
+        std::uint64_t skip = 0;
+        std::uint64_t count = std::numeric_limits<std::uint64_t>::max();
+        std::size_t depth = 256;
+        std::size_t limit = 64; // contents octets shown per value, 0 for all
+        std::string path = "-";
+
+        /**
+         * One past the last record to print.
+         */
+        [[nodiscard]] std::uint64_t End() const noexcept {
+            return count > std::numeric_limits<std::uint64_t>::max() - skip
+                   ? std::numeric_limits<std::uint64_t>::max() : skip + count;
+        }
+    };
+
+    constexpr std::array<char, 512> MakeHexTable() {
+        constexpr char digits[] = "0123456789abcdef";
+        std::array<char, 512> table{};
+        for (int i = 0; i < 256; ++i) {
+            table[2 * i] = digits[i >> 4];
+            table[2 * i + 1] = digits[i & 0xF];
+        }
+        return table;
+    }
+
+    constexpr auto hex_table = MakeHexTable();
+
+    constexpr std::array<std::string_view, 31> universal_names{
+            "EOC", "BOOLEAN", "INTEGER", "BIT STRING", "OCTET STRING", "NULL", "OBJECT IDENTIFIER",
+            "ObjectDescriptor", "EXTERNAL", "REAL", "ENUMERATED", "EMBEDDED PDV", "UTF8String", "RELATIVE-OID",
+            "", "", "SEQUENCE", "SET", "NumericString", "PrintableString", "T61String", "VideotexString",
+            "IA5String", "UTCTime", "GeneralizedTime", "GraphicString", "VisibleString", "GeneralString",
+            "UniversalString", "CHARACTER STRING", "BMPString"
+    };
+
+    /**
+     * Buffered writer, everything is formatted straight into one large buffer.
+     */
+    class Output {
+        static constexpr std::size_t capacity = 1 << 20;
+        static constexpr std::size_t max_reserve = 4096;
+
+        std::unique_ptr<char[]> buffer_{new char[capacity]};
+        std::size_t size_{};
+        int fd_;
+
+        char *Reserve(std::size_t n) {
+            if (capacity - size_ < n) {
+                Flush();
+            }
+            return buffer_.get() + size_;
+        }
+
+        void Commit(const char *end) noexcept {
+            size_ = static_cast<std::size_t>(end - buffer_.get());
+        }
+
+    public:
+        explicit Output(int fd) : fd_(fd) {}
+
+        void Flush() {
+            for (std::size_t done = 0; done < size_;) {
+                const auto written = ::write(fd_, buffer_.get() + done, size_ - done);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    throw std::system_error{errno, std::generic_category(), "write"};
+                }
+                done += static_cast<std::size_t>(written);
+            }
+            size_ = 0;
+        }
+
+        Output &Put(std::string_view str) {
+            while (!str.empty()) {
+                const auto n = std::min(str.size(), max_reserve);
+                auto *out = Reserve(n);
+                std::memcpy(out, str.data(), n);
+                Commit(out + n);
+                str.remove_prefix(n);
+            }
+            return *this;
+        }
+
+        Output &Put(char c) {
+            auto *out = Reserve(1);
+            *out++ = c;
+            Commit(out);
+            return *this;
+        }
+
+        template<class T>
+        Output &Number(T value) {
+            auto *out = Reserve(32);
+            Commit(std::to_chars(out, out + 32, value).ptr);
+            return *this;
+        }
+
+        /**
+         * Number right-aligned in a field of width characters.
+         */
+        Output &Number(std::uint64_t value, std::size_t width) {
+            char digits[24];
+            const auto len = static_cast<std::size_t>(
+                    std::to_chars(digits, digits + sizeof(digits), value).ptr - digits);
+            auto *out = Reserve(width + len);
+            if (len < width) {
+                out = std::fill_n(out, width - len, ' ');
+            }
+            Commit(std::copy_n(digits, len, out));
+            return *this;
+        }
+
+        Output &Indent(std::size_t n) {
+            while (n != 0) {
+                const auto step = std::min(n, max_reserve);
+                Commit(std::fill_n(Reserve(step), step, ' '));
+                n -= step;
+            }
+            return *this;
+        }
+
+        /**
+         * Octets as space separated hex pairs.
+         */
+        Output &Hex(OctetView octets) {
+            if (octets.empty()) {
+                return *this;
+            }
+            while (!octets.empty()) {
+                const auto n = std::min(octets.size(), max_reserve / 3);
+                auto *out = Reserve(3 * n);
+                for (std::size_t i = 0; i < n; ++i) {
+                    std::memcpy(out, hex_table.data() + 2 * octets[i], 2);
+                    out[2] = ' ';
+                    out += 3;
+                }
+                Commit(out);
+                octets.remove_prefix(n);
+            }
+            --size_; // trailing separator
+            return *this;
+        }
+
+        /**
+         * Octets as a quoted string, non-printable ones escaped as \xNN.
+         */
+        Output &Quoted(OctetView octets) {
+            Put('"');
+            while (!octets.empty()) {
+                const auto n = std::min(octets.size(), max_reserve / 4);
+                auto *out = Reserve(4 * n);
+                for (std::size_t i = 0; i < n; ++i) {
+                    const Octet c = octets[i];
+                    if (c < 0x20 || c >= 0x7F || c == '"' || c == '\\') {
+                        *out++ = '\\';
+                        *out++ = 'x';
+                        std::memcpy(out, hex_table.data() + 2 * c, 2);
+                        out += 2;
+                    } else {
+                        *out++ = static_cast<char>(c.octet_);
+                    }
+                }
+                Commit(out);
+                octets.remove_prefix(n);
+            }
+            return Put('"');
+        }
+    };
+
+    class Dumper {
+        static constexpr std::size_t offset_width = 12;
+
+        Output &out_;
+        const Options &options_;
+
+        [[nodiscard]] OctetView Limited(OctetView content) const noexcept {
+            return options_.limit == 0 ? content : content.substr(0, options_.limit);
+        }
+
+        void Ellipsis(OctetView content) {
+            if (options_.limit != 0 && content.size() > options_.limit) {
+                out_.Put(" ...");
+            }
+        }
+
+        void Tag(const TlvView &tlv) {
+            const auto class_tag = tlv.ClassTag().value;
+            const auto tag = tlv.TagNumber();
+            if (class_tag == IdentifierOctet::Universal.value) {
+                if (tag < universal_names.size() && !universal_names[tag].empty()) {
+                    out_.Put(universal_names[tag]);
+                } else {
+                    out_.Put("[UNIVERSAL ").Number(tag).Put(']');
+                }
+            } else if (class_tag == IdentifierOctet::Application.value) {
+                out_.Put("[APPLICATION ").Number(tag).Put(']');
+            } else if (class_tag == IdentifierOctet::ContextSpecific.value) {
+                out_.Put('[').Number(tag).Put(']');
+            } else {
+                out_.Put("[PRIVATE ").Number(tag).Put(']');
+            }
+        }
+
+        void HexValue(OctetView content) {
+            if (content.empty()) {
+                return;
+            }
+            out_.Put(": ").Hex(Limited(content));
+            Ellipsis(content);
+        }
+
+        void TextValue(OctetView content) {
+            out_.Put(": ").Quoted(Limited(content));
+            Ellipsis(content);
+        }
+
+        template<class Oid>
+        void Arcs(const Oid &oid) {
+            out_.Put(": ");
+            for (std::size_t i = 0; i < oid.arcs.size(); ++i) {
+                if (i != 0) {
+                    out_.Put('.');
+                }
+                out_.Number(oid.arcs[i]);
+            }
+        }
+
+        /**
+         * Value of a primitive universal type, throws on malformed contents before anything is written.
+         */
+        void UniversalValue(std::uintmax_t tag, OctetView content) {
+            switch (tag) {
+                case UniversalTagList::BOOLEAN:
+                    if (content.size() != 1) {
+                        throw std::logic_error{"Sizes' mismatch"};
+                    }
+                    out_.Put(content[0] != 0 ? ": TRUE" : ": FALSE");
+                    return;
+                case UniversalTagList::INTEGER:
+                case UniversalTagList::ENUMERATED:
+                    if (content.size() > sizeof(IntType)) {
+                        HexValue(content);
+                    } else {
+                        const auto value = detail::DecodeIntegralImpl(content);
+                        out_.Put(": ").Number(value);
+                    }
+                    return;
+                case UniversalTagList::NULL_TYPE:
+                    if (!content.empty()) {
+                        throw std::logic_error{"Sizes' mismatch"};
+                    }
+                    return;
+                case UniversalTagList::REAL: {
+                    const auto value = detail::DecodeRealImpl(content);
+                    out_.Put(": ").Number(value);
+                    return;
+                }
+                case UniversalTagList::OBJECT_IDENTIFIER:
+                    Arcs(DecodeObjectIdentifierContent(content));
+                    return;
+                case UniversalTagList::RELATIVE_OID:
+                    Arcs(DecodeRelativeOidContent(content));
+                    return;
+                case UniversalTagList::BIT_STRING:
+                    if (content.empty() || content[0] > 7) {
+                        throw std::logic_error{"Malformed BIT STRING"};
+                    }
+                    out_.Put(": unused ").Number(static_cast<int>(content[0]));
+                    if (content.size() > 1) {
+                        out_.Put(',');
+                        HexValue(content.substr(1));
+                    }
+                    return;
+                case UniversalTagList::UTCTime:
+                    ParseUtcTime(content);
+                    TextValue(content);
+                    return;
+                case UniversalTagList::GeneralizedTime:
+                    ParseGeneralizedTime(content);
+                    TextValue(content);
+                    return;
+                case UniversalTagList::ObjectDescriptor:
+                case UniversalTagList::UTF8String:
+                case UniversalTagList::NumericString:
+                case UniversalTagList::PrintableString:
+                case UniversalTagList::T61String:
+                case UniversalTagList::VideotexString:
+                case UniversalTagList::IA5String:
+                case UniversalTagList::GraphicString:
+                case UniversalTagList::VisibleString:
+                case UniversalTagList::GeneralString:
+                    if (!IsValidCharacterString(static_cast<UniversalTagList::Type>(tag), content)) {
+                        throw std::logic_error{"Invalid character"};
+                    }
+                    TextValue(content);
+                    return;
+                default:
+                    HexValue(content);
+                    return;
+            }
+        }
+
+        void Node(const TlvView &tlv, std::uint64_t offset, std::size_t depth) {
+            out_.Number(offset, offset_width).Indent(2 + 2 * depth);
+            Tag(tlv);
+            if (tlv.IsConstructed()) {
+                out_.Put(" cons");
+            }
+            if (tlv.IsInDefinite()) {
+                out_.Put(" len=indef");
+            } else {
+                out_.Put(" len=").Number(tlv.Header().length);
+            }
+
+            if (!tlv.IsConstructed()) {
+                const auto content = tlv.Content();
+                if (tlv.ClassTag().value != IdentifierOctet::Universal.value) {
+                    HexValue(content);
+                } else {
+                    // a failed decode has written nothing yet and falls back to hex
+                    try {
+                        UniversalValue(tlv.TagNumber(), content);
+                    } catch (const std::logic_error &e) {
+                        HexValue(content);
+                        out_.Put(" (malformed: ").Put(e.what()).Put(')');
+                    }
+                }
+                out_.Put('\n');
+                return;
+            }
+
+            out_.Put('\n');
+            if (depth + 1 >= options_.depth) {
+                return;
+            }
+            const auto base = tlv.Bytes().data();
+            try {
+                for (auto &&child : tlv.Children()) {
+                    Node(child, offset + static_cast<std::uint64_t>(child.Bytes().data() - base), depth + 1);
+                }
+            } catch (const std::logic_error &e) {
+                out_.Indent(offset_width + 2 + 2 * (depth + 1)).Put("!! ").Put(e.what()).Put('\n');
+            }
+        }
+
+    public:
+        Dumper(Output &out, const Options &options) : out_(out), options_(options) {}
+
+        void Record(std::uint64_t number, const TlvView &tlv, std::uint64_t offset) {
+            out_.Put('#').Number(number).Put('\n');
+            Node(tlv, offset, 0);
+        }
+    };
+
+    /**
+     * Walk a memory mapped file, records before --skip only have their header parsed.
+     */
+    void DumpFile(const std::string &path, const Options &options, Dumper &dumper) {
+        const MappedFile file{path};
+        if (options.skip == 0) {
+            file.Advise(MADV_SEQUENTIAL);
+        }
+
+        const auto view = file.View();
+        const auto end = options.End();
+        std::uint64_t record = 0;
+        for (std::size_t pos = 0; pos < view.size() && record < end; ++record) {
+            TlvView tlv;
+            try {
+                tlv = TlvView{view.substr(pos)};
+            } catch (const std::logic_error &e) {
+                throw std::runtime_error{"record " + std::to_string(record) + " at offset " + std::to_string(pos) +
+                                         ": " + e.what()};
+            }
+            if (record >= options.skip) {
+                dumper.Record(record, tlv, pos);
+            }
+            pos += tlv.Bytes().size();
+        }
     }
-    if (str[1].SubBits<7,7>() == 1) {
-        for (int i = 0; i < str[1].SubBits<6,0>(); ++i) {
-            os << std::hex << std::setw(2) << std::setfill('0') << (unsigned short) str[i] << ' ';
+
+    constexpr std::size_t max_streamed_record = std::size_t{1} << 30;
+
+    /**
+     * Stream stdin through StreamDecoder, records straddling reads are the only ones buffered.
+     */
+    void DumpStdin(const Options &options, Dumper &dumper) {
+        StreamDecoder decoder{max_streamed_record};
+        std::unique_ptr<Octet[]> chunk{new Octet[1 << 20]};
+        const auto end = options.End();
+        std::uint64_t record = 0;
+        std::uint64_t offset = 0;
+
+        while (record < end) {
+            const auto got = ::read(STDIN_FILENO, chunk.get(), 1 << 20);
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::system_error{errno, std::generic_category(), "read"};
+            }
+            if (got == 0) {
+                break;
+            }
+            decoder.Feed(OctetView(chunk.get(), static_cast<std::size_t>(got)), [&](const StreamDecoder::Tlv &tlv) {
+                if (record >= options.skip && record < end) {
+                    dumper.Record(record, TlvView{tlv.bytes}, offset);
+                }
+                offset += tlv.bytes.size();
+                ++record;
+            });
+        }
+
+        if (!decoder.IsIdle() && record < end) {
+            throw std::runtime_error{"record " + std::to_string(record) + " at offset " + std::to_string(offset) +
+                                     " is truncated"};
         }
     }
-    os << '\n';
-    for (int i = 2; i < str.size(); ++i) {
-        os << std::hex << std::setw(2) << std::setfill('0')  << (unsigned short) str[i];
+
+    bool ParseNumber(std::string_view text, std::uint64_t &value) {
+        const auto[ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return ec == std::errc{} && ptr == text.data() + text.size();
     }
-    return os;
-}
 
-int main() {
-    auto encoded = Encode(FromString("Lorem ipsum dolor sit amet, consectetur adipiscing elit. Suspendisse egestas posuere tellus, sed egestas mauris efficitur quis. Fusce convallis, libero nec vestibulum scelerisque, arcu nibh ullamcorper ex, ullamcorper blandit ex odio sed augue. Nulla quis ultrices justo. Duis tempus velit a augue posuere rutrum. Nam lacinia lacus eu felis accumsan scelerisque. Nulla non sollicitudin dui. Curabitur a molestie est, ac euismod tortor. Sed egestas, dui ac aliquam tempor, sapien tortor vestibulum orci, non sagittis ipsum purus eget ipsum. Suspendisse commodo imperdiet imperdiet. Aenean vitae diam a nisi dignissim posuere in ac velit. Suspendisse varius odio in egestas ornare. Vivamus congue, est ut eleifend varius, erat orci tempus eros, eu dictum augue libero non ante.\n"
-                                     "\n"
-                                     "Suspendisse in nulla eget arcu accumsan molestie sit amet ac ligula. Nullam id mauris id justo hendrerit faucibus in at diam. Sed ipsum quam, condimentum vel ultrices sed, eleifend nec ligula. Etiam vel massa id eros maximus tristique sit amet ac elit. Integer aliquet arcu et quam scelerisque, non varius nibh maximus. Integer faucibus dolor nulla, ut condimentum massa dignissim rhoncus. Integer feugiat laoreet dui non convallis. Praesent hendrerit diam nec nulla finibus porta. Etiam suscipit, orci ac ornare ultrices, arcu ligula dictum nisi, quis dictum neque nisl quis lacus. Ut erat odio, efficitur vestibulum mauris a, pulvinar facilisis dui. In consectetur enim et aliquam laoreet. Morbi iaculis eros quam, vel posuere nisi aliquet cursus. Ut interdum urna nec vehicula sollicitudin.\n"
-                                     "\n"
-                                     "Nullam pharetra urna sollicitudin augue elementum faucibus. Vivamus dolor turpis, finibus non metus et, venenatis aliquet orci. Cras pretium turpis sed metus laoreet congue. Quisque molestie rutrum magna sed scelerisque. Nulla scelerisque risus a accumsan sollicitudin. Vestibulum sit amet nulla convallis, maximus risus ac, blandit erat. Class aptent taciti sociosqu ad litora torquent per conubia nostra, per inceptos himenaeos. Maecenas vulputate, est nec tempus venenatis, neque neque mollis dui, eget blandit lacus elit a mauris. Donec blandit leo ornare laoreet semper. Praesent suscipit sed erat sed pellentesque. Suspendisse potenti.\n"
-                                     "\n"
-                                     "Suspendisse ante ipsum, rhoncus non imperdiet nec, faucibus vel augue. Aliquam erat volutpat. Vivamus ultrices, lacus convallis semper blandit, nibh erat consectetur tellus, at placerat velit eros a nulla. Duis eget nunc in lorem varius tincidunt sit amet id nibh. Fusce volutpat dui at dui mattis, vehicula volutpat magna viverra. In euismod ex id turpis hendrerit rhoncus. Pellentesque at justo id lectus vehicula dapibus non sit amet elit. Fusce dictum tortor laoreet augue congue, eget sollicitudin lacus porta.\n"
-                                     "\n"
-                                     "Vestibulum eget ante eget orci aliquam dignissim. Aliquam sit amet hendrerit augue, in sodales mauris. Ut lacus tellus, venenatis nec augue pellentesque, varius porta sapien. Quisque fermentum varius molestie. Nam eget diam diam. In vulputate, augue id mollis accumsan, urna eros malesuada nisi, id tristique justo purus ac leo. Nulla ante ipsum, sagittis id mollis quis, aliquam sit amet tellus. Proin sollicitudin metus metus, vel sollicitudin libero viverra nec. Praesent sed velit odio. Quisque laoreet mi nec porttitor rhoncus. Donec tristique, ligula at elementum porta, justo lacus porttitor neque, sed venenatis velit nulla vitae augue. Phasellus ultricies neque mi.\n"
-                                     ""));
+    bool ParseOptions(int argc, char **argv, Options &options) {
+        bool have_path = false;
+        for (int i = 1; i < argc; ++i) {
+            const std::string_view arg{argv[i]};
+            const auto value = arg.substr(std::min(arg.find('=') + 1, arg.size()));
+            std::uint64_t number = 0;
+            bool ok = true;
 
-    std::cout << encoded;
+            if (arg.starts_with("--skip=")) {
+                ok = ParseNumber(value, options.skip);
+            } else if (arg.starts_with("--count=")) {
+                ok = ParseNumber(value, options.count);
+            } else if (arg.starts_with("--depth=")) {
+                ok = ParseNumber(value, number) && number != 0;
+                options.depth = static_cast<std::size_t>(std::min<std::uint64_t>(number, 256));
+            } else if (arg.starts_with("--limit=")) {
+                ok = ParseNumber(value, number);
+                options.limit = static_cast<std::size_t>(number);
+            } else if (!have_path && (arg == "-" || !arg.starts_with("-"))) {
+                options.path = arg;
+                have_path = true;
+            } else {
+                ok = false;
+            }
 
+            if (!ok) {
+                std::cerr << "usage: " << argv[0] << " [--skip=N] [--count=N] [--depth=N] [--limit=N] [FILE|-]\n"
+                          << "  --skip=N   start at top-level record N (0-based)\n"
+                          << "  --count=N  print at most N records\n"
+                          << "  --depth=N  print N levels of nesting, 1 for top-level TLVs only\n"
+                          << "  --limit=N  show at most N contents octets per value, 0 for all (default 64)\n";
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    Output out{STDOUT_FILENO};
+    Dumper dumper{out, options};
+    try {
+        struct stat st{};
+        if (options.path != "-") {
+            DumpFile(options.path, options, dumper);
+        } else if (::fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode)) {
+            DumpFile("/dev/stdin", options, dumper);
+        } else {
+            DumpStdin(options, dumper);
+        }
+        out.Flush();
+    } catch (const std::exception &e) {
+        try {
+            out.Flush();
+        } catch (const std::exception &) {
+        }
+        std::cerr << "error: " << e.what() << '\n';
+        return 1;
+    }
     return 0;
 }